@@ -5,24 +5,28 @@
 #ifndef SSIG_HPP_INCLUDED
 #define SSIG_HPP_INCLUDED SSIG_HPP_INCLUDED
 
-#ifndef SSIG_MAX_ARGS
-#   define SSIG_MAX_ARGS 5
+#ifndef SSIG_DELEGATE_BUFFER_SIZE
+#   define SSIG_DELEGATE_BUFFER_SIZE (3 * sizeof(void*))
 #endif
 
 #include <boost/function.hpp>
-#include <boost/next_prior.hpp>
-#include <boost/preprocessor/enum.hpp>
-#include <boost/preprocessor/iteration/iterate.hpp>
-#include <boost/preprocessor/repetition/enum_trailing_params.hpp>
-#include <boost/preprocessor/repetition/enum_trailing.hpp>
-#include <boost/preprocessor/repetition/enum_binary_params.hpp>
-#include <boost/preprocessor/control/expr_if.hpp>
-#include <boost/smart_ptr/make_shared.hpp>
-#include <boost/smart_ptr/shared_ptr.hpp>
-#include <boost/smart_ptr/weak_ptr.hpp>
-
-#include <forward_list>
+#include <boost/smart_ptr/intrusive_ptr.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ssig_stats.hpp"
+#include "ssig_trace.hpp"
 
 
 namespace ssig {
@@ -34,11 +38,419 @@ public:
     SsigError(std::string const& msg): std::logic_error(msg) { }
 };
 
+template<class Signature, std::size_t BufferSize = SSIG_DELEGATE_BUFFER_SIZE>
+class Delegate;
+
+// Threading policies: they determine how the lifetime of a Signal's slot
+// table, which is shared with its Connections, is tracked.
+
+// Plain reference counting: Connections of a signal must only be copied and
+// destroyed by one thread at a time.
+struct SingleThreaded {
+    typedef std::size_t counter_type;
+    static void increment(counter_type& c) { ++c; }
+    static bool decrement(counter_type& c) { return --c == 0; }
+};
+
+// Atomic reference counting: Connections may be copied and destroyed
+// concurrently from multiple threads.
+struct MultiThreaded {
+    typedef std::atomic<std::size_t> counter_type;
+    static void increment(counter_type& c) { c.fetch_add(1, std::memory_order_relaxed); }
+    static bool decrement(counter_type& c)
+    {
+        return c.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+};
+
+// Memory pool for the slot tables of Signals using a PoolAllocator.
+// Freed blocks are kept in free lists and reused; reset() makes all memory
+// available again at once, e.g. at the end of a frame. Not thread safe, so
+// use one pool per thread.
+class SlotPool {
+public:
+    explicit SlotPool(std::size_t chunkSize = 16 * 1024):
+        m_chunkSize(chunkSize), m_current(0), m_offset(0), m_capacity(0)
+    {
+        std::fill(m_freeLists, m_freeLists + numSizeClasses, nullptr);
+    }
+
+    ~SlotPool()
+    {
+        for (auto const& chunk: m_chunks)
+            ::operator delete(chunk.memory);
+    }
+
+    void* allocate(std::size_t size)
+    {
+        unsigned const sizeClass = sizeClassOf(size);
+        if (FreeBlock* block = m_freeLists[sizeClass]) {
+            m_freeLists[sizeClass] = block->next;
+            return block;
+        }
+        std::size_t const blockSize = blockSizeOf(sizeClass);
+        for (; m_current < m_chunks.size(); ++m_current, m_offset = 0) {
+            Chunk const& chunk = m_chunks[m_current];
+            if (chunk.size - m_offset >= blockSize) {
+                void* const block = chunk.memory + m_offset;
+                m_offset += blockSize;
+                return block;
+            }
+        }
+        std::size_t const chunkSize = std::max(m_chunkSize, blockSize);
+        if (m_chunks.size() == m_chunks.capacity()) // so that push_back cannot throw
+            m_chunks.reserve(m_chunks.size() * 2 + 1);
+        m_chunks.push_back(Chunk(static_cast<char*>(::operator new(chunkSize)), chunkSize));
+        m_capacity += chunkSize;
+        m_offset = blockSize;
+        return m_chunks.back().memory;
+    }
+
+    void deallocate(void* p, std::size_t size)
+    {
+        unsigned const sizeClass = sizeClassOf(size);
+        FreeBlock* const block = static_cast<FreeBlock*>(p);
+        block->next = m_freeLists[sizeClass];
+        m_freeLists[sizeClass] = block;
+    }
+
+    // Makes all memory of the pool available again. Everything allocated
+    // from the pool must have been destroyed before.
+    void reset()
+    {
+        std::fill(m_freeLists, m_freeLists + numSizeClasses, nullptr);
+        m_current = 0;
+        m_offset = 0;
+    }
+
+    // Total number of bytes obtained from the global heap.
+    std::size_t capacity() const { return m_capacity; }
+
+private:
+    struct FreeBlock { FreeBlock* next; };
+    struct Chunk {
+        Chunk(char* memory, std::size_t size): memory(memory), size(size) { }
+        char* memory;
+        std::size_t size;
+    };
+
+    static std::size_t const minBlockSize = sizeof(void*) * 2;
+    static unsigned const numSizeClasses = sizeof(std::size_t) * 8;
+
+    static unsigned sizeClassOf(std::size_t size)
+    {
+        unsigned sizeClass = 0;
+        while (blockSizeOf(sizeClass) < size)
+            ++sizeClass;
+        return sizeClass;
+    }
+
+    static std::size_t blockSizeOf(unsigned sizeClass)
+    {
+        return minBlockSize << sizeClass;
+    }
+
+    std::size_t const m_chunkSize;
+    std::vector<Chunk> m_chunks;
+    std::size_t m_current; // chunk to allocate new blocks from
+    std::size_t m_offset;  // in m_chunks[m_current]
+    std::size_t m_capacity;
+    FreeBlock* m_freeLists[numSizeClasses];
+
+    SlotPool(SlotPool const&);
+    SlotPool& operator=(SlotPool const&);
+};
+
+// Allocator which obtains memory from a SlotPool.
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    PoolAllocator(SlotPool& pool): m_pool(&pool) { }
+
+    template <typename U>
+    PoolAllocator(PoolAllocator<U> const& rhs): m_pool(&rhs.pool()) { }
+
+    T* allocate(std::size_t n)
+    {
+        static_assert(std::alignment_of<T>::value <= 2 * sizeof(void*),
+            "type is over-aligned for SlotPool");
+        return static_cast<T*>(m_pool->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) { m_pool->deallocate(p, n * sizeof(T)); }
+
+    SlotPool& pool() const { return *m_pool; }
+
+private:
+    SlotPool* m_pool;
+};
+
+template <typename T, typename U>
+bool operator== (PoolAllocator<T> const& lhs, PoolAllocator<U> const& rhs)
+{
+    return &lhs.pool() == &rhs.pool();
+}
+
+template <typename T, typename U>
+bool operator!= (PoolAllocator<T> const& lhs, PoolAllocator<U> const& rhs)
+{
+    return !(lhs == rhs);
+}
+
+// Combiners for Signal::emit<Combiner>() and Signal::combine(): each result
+// of a slot is passed to operator(), which returns false if no further slots
+// need to be called. result() returns the combined result.
+
+template <typename T>
+class Sum {
+public:
+    typedef T result_type;
+    Sum(): m_sum() { }
+    bool operator() (T const& value) { m_sum += value; return true; }
+    T result() const { return m_sum; }
+private:
+    T m_sum;
+};
+
+template <typename T>
+class Minimum {
+public:
+    typedef T result_type;
+    Minimum(): m_value(), m_empty(true) { }
+    bool operator() (T const& value)
+    {
+        if (m_empty || value < m_value)
+            m_value = value;
+        m_empty = false;
+        return true;
+    }
+    T result() const
+    {
+        if (m_empty)
+            throw SsigError("attempt to invoke empty signal with non-void return type");
+        return m_value;
+    }
+private:
+    T m_value;
+    bool m_empty;
+};
+
+template <typename T>
+class Maximum {
+public:
+    typedef T result_type;
+    Maximum(): m_value(), m_empty(true) { }
+    bool operator() (T const& value)
+    {
+        if (m_empty || m_value < value)
+            m_value = value;
+        m_empty = false;
+        return true;
+    }
+    T result() const
+    {
+        if (m_empty)
+            throw SsigError("attempt to invoke empty signal with non-void return type");
+        return m_value;
+    }
+private:
+    T m_value;
+    bool m_empty;
+};
+
+// True if any slot returns true; stops at the first one that does.
+class AnyOf {
+public:
+    typedef bool result_type;
+    AnyOf(): m_any(false) { }
+    bool operator() (bool value) { m_any = value; return !value; }
+    bool result() const { return m_any; }
+private:
+    bool m_any;
+};
+
+// True unless a slot returns false (vetoes); stops at the first one that does.
+class AllOf {
+public:
+    typedef bool result_type;
+    AllOf(): m_all(true) { }
+    bool operator() (bool value) { m_all = value; return value; }
+    bool result() const { return m_all; }
+private:
+    bool m_all;
+};
+
+// Stores the results in the caller-provided range [begin, end); stops when
+// it is full. result() returns the number of stored results.
+template <typename T>
+class CollectInto {
+public:
+    typedef std::size_t result_type;
+    CollectInto(T* begin, T* end): m_begin(begin), m_next(begin), m_end(end) { }
+    bool operator() (T const& value)
+    {
+        if (m_next == m_end)
+            return false;
+        *m_next++ = value;
+        return m_next != m_end;
+    }
+    std::size_t result() const { return m_next - m_begin; }
+private:
+    T* m_begin;
+    T* m_next;
+    T* m_end;
+};
+
+// A view of a contiguous array, e.g. of the events handed to the batch slots
+// of a QueuedSignal. Only valid for the duration of the call it is passed to.
+template <typename T>
+class Span {
+public:
+    typedef T value_type;
+    typedef T* iterator;
+
+    Span(): m_data(nullptr), m_size(0) { }
+    Span(T* data, std::size_t size): m_data(data), m_size(size) { }
+
+    T* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+    T& operator[] (std::size_t i) const { return m_data[i]; }
+
+private:
+    T* m_data;
+    std::size_t m_size;
+};
+
 namespace detail {
 
 template <typename Signature>
 struct SignalInvoker;
 
+template <typename Signature, Signature*... Slots>
+struct StaticInvoker;
+
+// A slot which hands its invocations over to an executor, e.g. a Mailbox
+// (see ssig_mailbox.hpp).
+template <typename Signature, typename Function, typename Executor>
+class ExecutorSlot;
+
+// Calls the slots of a signal on a ThreadPool (see ssig_parallel.hpp).
+template <typename Pool>
+struct ParallelInvoker;
+
+// The type as which an argument of a signal is passed along the dispatch
+// chain: by value if copying it is as cheap as passing a reference, by const
+// reference otherwise, so that it is never copied before a slot needs a copy.
+// References are passed as such.
+template <typename A>
+struct ParamType {
+    typedef typename std::conditional<std::is_scalar<A>::value, A, A const&>::type type;
+};
+
+template <typename A>
+struct ParamType<A&> { typedef A& type; };
+
+template <typename A>
+struct ParamType<A&&> { typedef A&& type; };
+
+// The type as which an argument of a signal is passed on to each slot:
+// rvalue references are passed on as rvalues to every slot, everything else
+// as an lvalue. A slot moving from an rvalue reference argument thus leaves
+// the slots called after it with a moved-from object.
+template <typename A>
+struct SlotArg { typedef A const& type; };
+
+template <typename A>
+struct SlotArg<A&> { typedef A& type; };
+
+template <typename A>
+struct SlotArg<A&&> { typedef A&& type; };
+
+// Passes the parameter arg of a signal with argument type A on to a slot.
+template <typename A, typename T>
+typename SlotArg<A>::type slotArg(T& arg)
+{
+    return static_cast<typename SlotArg<A>::type>(arg);
+}
+
+// Passes an element of a stored argument tuple on to a slot as SlotArg does.
+// Elements of const tuples are passed on as const lvalues.
+template <typename A>
+struct BatchArg {
+    template <typename T>
+    static T& get(T& element) { return element; }
+};
+
+template <typename A>
+struct BatchArg<A&&> {
+    template <typename T>
+    static A&& get(T& element) { return static_cast<A&&>(element); }
+};
+
+// The type in which an emission is stored, e.g. by QueuedSignal: the
+// argument itself for signals with a single parameter, so that batch slots
+// receive arrays of plain values, and a tuple of the arguments otherwise.
+template <typename... Args>
+struct EventType {
+    typedef std::tuple<typename std::decay<Args>::type...> type;
+};
+
+template <typename A>
+struct EventType<A> {
+    typedef typename std::decay<A>::type type;
+};
+
+// Compile time list of indices, used to expand stored argument tuples.
+template <std::size_t... Is>
+struct IndexSequence { };
+
+template <std::size_t N, std::size_t... Is>
+struct MakeIndexSequence: MakeIndexSequence<N - 1, N - 1, Is...> { };
+
+template <std::size_t... Is>
+struct MakeIndexSequence<0, Is...> { typedef IndexSequence<Is...> type; };
+
+enum DelegateOperation { delegateCopy, delegateMove, delegateDestroy };
+
+// Copies, moves or destroys a callable of type F stored in a Delegate buffer.
+template <typename F>
+void manageDelegate(DelegateOperation op, void* dst, void* src)
+{
+    switch (op) {
+        case delegateCopy:
+            new (dst) F(*static_cast<F const*>(src));
+            break;
+        case delegateMove:
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+            break;
+        case delegateDestroy:
+            static_cast<F*>(dst)->~F();
+            break;
+    }
+}
+
+// True for null function and member pointers, from which a Delegate is
+// constructed empty, as a boost::function is.
+template <typename F>
+typename std::enable_if<std::is_pointer<F>::value || std::is_member_pointer<F>::value,
+    bool>::type isNullCallable(F f)
+{
+    return f == nullptr;
+}
+
+template <typename F>
+typename std::enable_if<!std::is_pointer<F>::value && !std::is_member_pointer<F>::value,
+    bool>::type isNullCallable(F const&)
+{
+    return false;
+}
+
 struct Calling {
     Calling(bool& b): b(b)
     {
@@ -53,6 +465,515 @@ private:
     Calling& operator=(Calling const&); // silence warning
 };
 
+// Releases resources held by a disconnected slot without destroying it.
+template <typename Function>
+void releaseSlot(Function&) { }
+
+template <typename Signature>
+void releaseSlot(boost::function<Signature>& f) { f.clear(); }
+
+template <typename Function>
+bool isEmptySlot(Function const&) { return false; }
+
+template <typename Signature>
+bool isEmptySlot(boost::function<Signature> const& f) { return f.empty(); }
+
+template <typename Signature, std::size_t BufferSize>
+void releaseSlot(Delegate<Signature, BufferSize>& f) { f.clear(); }
+
+template <typename Signature, std::size_t BufferSize>
+bool isEmptySlot(Delegate<Signature, BufferSize> const& f) { return f.empty(); }
+
+// Keeps a copy of an allocator; empty (i.e. stateless) allocators take no
+// space when this is used as a base class.
+template <typename Allocator, bool IsEmpty = std::is_empty<Allocator>::value>
+class AllocatorHolder: private Allocator {
+public:
+    explicit AllocatorHolder(Allocator const& alloc): Allocator(alloc) { }
+    Allocator const& allocator() const { return *this; }
+};
+
+template <typename Allocator>
+class AllocatorHolder<Allocator, false> {
+public:
+    explicit AllocatorHolder(Allocator const& alloc): m_allocator(alloc) { }
+    Allocator const& allocator() const { return m_allocator; }
+private:
+    Allocator m_allocator;
+};
+
+// The name of a signal whose slot table is created later, as by
+// CompactSignal. It is only kept if statistics or tracing are enabled, and
+// takes no space otherwise when used as a base class.
+#if defined(SSIG_ENABLE_STATS) || defined(SSIG_ENABLE_TRACING)
+class DeferredName {
+public:
+    explicit DeferredName(char const* name = nullptr): m_name(name) { }
+    void setName(char const* name) { m_name = name; }
+    char const* name() const { return m_name; }
+private:
+    char const* m_name;
+};
+#else
+class DeferredName {
+public:
+    explicit DeferredName(char const* = nullptr) { }
+    void setName(char const*) { }
+    char const* name() const { return nullptr; }
+};
+#endif
+
+// Contiguous slot storage of a Signal.
+// Slots are kept in one array in calling order (reversed) so that emitting a
+// signal is a linear scan. Slots connected with a priority other than 0 split
+// the array into bands of equal priority, ordered by descending priority;
+// within a band, slots are in connection order. Connections refer to a slot
+// by an (id, generation) handle which stays valid when the array is compacted
+// and becomes invalid when the slot is disconnected. The table is reference
+// counted by its Signal and Connections according to the Threading policy.
+template <typename Function, typename Allocator, typename Threading>
+class SlotTable: private SignalStats, private SignalTrace {
+public:
+    typedef std::size_t id_type;
+    static id_type const invalidId = static_cast<id_type>(-1);
+
+    struct Slot {
+        Slot(Function const& function, id_type id): function(function), id(id) { }
+        explicit Slot(id_type id): function(), id(id) { } // free
+        Function function;
+        id_type id; // invalidId if disconnected
+    };
+
+    typedef std::vector<Slot, typename
+        std::allocator_traits<Allocator>::template rebind_alloc<Slot>> container_type;
+
+    // While a Deferral exists, the slot array is neither reallocated nor
+    // compacted, i.e. references to slots stay valid. Slots connected in the
+    // meantime are appended, and slots disconnected in the meantime are
+    // released, when the last Deferral is destroyed.
+    class Deferral {
+    public:
+        Deferral(SlotTable& table): m_table(table) { ++m_table.m_deferring; }
+        ~Deferral()
+        {
+            if (--m_table.m_deferring != 0)
+                return;
+            if (!m_table.m_released.empty())
+                m_table.releaseDisconnected();
+            if (!m_table.m_pending.empty())
+                m_table.flushPending();
+        }
+    private:
+        SlotTable& m_table;
+
+        Deferral& operator=(Deferral const&); // silence warning
+    };
+
+    // alloc is an Allocator or a rebound copy of it, e.g. allocator().
+    template <typename Alloc>
+    static SlotTable* create(Alloc const& alloc)
+    {
+        table_allocator tableAlloc(alloc);
+        SlotTable* const table = table_traits::allocate(tableAlloc, 1);
+        try {
+            return new (table) SlotTable(alloc);
+        } catch (...) {
+            table_traits::deallocate(tableAlloc, table, 1);
+            throw;
+        }
+    }
+
+    typename container_type::allocator_type allocator() const
+    {
+        return m_slots.get_allocator();
+    }
+
+    friend void intrusive_ptr_add_ref(SlotTable* table)
+    {
+        Threading::increment(table->m_refs);
+    }
+
+    friend void intrusive_ptr_release(SlotTable* table)
+    {
+        if (Threading::decrement(table->m_refs)) {
+            table_allocator tableAlloc(table->m_slots.get_allocator());
+            table->~SlotTable();
+            table_traits::deallocate(tableAlloc, table, 1);
+        }
+    }
+
+    id_type connect(Function const& function, unsigned& generation, int priority = 0)
+    {
+        id_type id;
+        if (m_freeIds.empty()) {
+            id = m_handles.size();
+            m_handles.push_back(Handle());
+        } else {
+            id = m_freeIds.back();
+            m_freeIds.pop_back();
+        }
+        Handle& handle = m_handles[id];
+        generation = handle.generation;
+        if (m_deferring) {
+            handle.index = m_slots.size() + m_pending.size();
+            m_pending.push_back(Slot(function, id));
+            m_pendingPriorities.push_back(priority);
+        } else {
+            insert(Slot(function, id), priority);
+        }
+        ++m_numLive;
+        connected();
+        return id;
+    }
+
+    bool isConnected(id_type id, unsigned generation) const
+    {
+        return id < m_handles.size() && m_handles[id].generation == generation;
+    }
+
+    Slot& slot(id_type id)
+    {
+        std::size_t const index = m_handles[id].index;
+        return index < m_slots.size() ?
+            m_slots[index] : m_pending[index - m_slots.size()];
+    }
+
+    void disconnect(id_type id)
+    {
+        Slot& s = slot(id);
+        s.id = invalidId;
+        ++m_handles[id].generation;
+        m_freeIds.push_back(id);
+        ++m_numDead;
+        --m_numLive;
+        disconnected();
+        if (m_deferring)
+            m_released.push_back(m_handles[id].index);
+        else
+            releaseSlot(s.function);
+    }
+
+    // True if the share of disconnected and free slots exceeds the
+    // compaction threshold, so that compact() should be called.
+    bool needsCompaction() const
+    {
+        return m_numDead + m_numFree > m_compactionThreshold * m_slots.size();
+    }
+
+    void setCompactionThreshold(float deadRatio) { m_compactionThreshold = deadRatio; }
+
+    // Compacts the table if necessary and possible, as Emission does.
+    void compactIfNeeded()
+    {
+        if (!deferring() && needsCompaction())
+            compact();
+    }
+
+    // Lives during an emission: prevents recursive emissions, removes
+    // disconnected slots if necessary and records statistics and traces.
+    // Does not compact while deferring, e.g. when emitted by a slot called
+    // through Connection::invokeSlot(), which must not be moved.
+    class Emission {
+    public:
+        explicit Emission(SlotTable& table): m_lock(table.m_calling), m_trace(table)
+        {
+            table.emitted();
+            table.compactIfNeeded();
+        }
+    private:
+        Calling m_lock;
+        SignalTrace::Emission m_trace;
+    };
+
+    // Lives during the call of a slot.
+    class SlotCall {
+    public:
+        SlotCall(SlotTable& table, id_type id): m_stats(table), m_trace(table, id) { }
+    private:
+        SignalStats::SlotCall m_stats;
+        SignalTrace::SlotCall m_trace;
+    };
+
+    // Removes disconnected and free slots, and bands which become empty.
+    // Must not be called while deferring.
+    void compact()
+    {
+        std::size_t in = 0;
+        std::size_t out = 0;
+        auto outBand = m_bands.begin();
+        for (auto band = m_bands.begin(); ; ++band) {
+            std::size_t const end = band == m_bands.end() ? m_slots.size() : band->end;
+            for (; in < end; ++in) {
+                if (m_slots[in].id == invalidId)
+                    continue;
+                if (out != in) {
+                    m_slots[out] = std::move(m_slots[in]);
+                    m_handles[m_slots[out].id].index = out;
+                }
+                ++out;
+            }
+            if (band == m_bands.end())
+                break;
+            if (out != (outBand == m_bands.begin() ? 0 : (outBand - 1)->end)) {
+                *outBand = *band;
+                outBand->top = outBand->end = out;
+                ++outBand;
+            }
+        }
+        m_slots.erase(m_slots.begin() + out, m_slots.end());
+        m_bands.erase(outBand, m_bands.end());
+        swept(m_numDead);
+        m_numDead = 0;
+        m_numFree = 0;
+    }
+
+    // Disconnects and destroys all slots. Called when the Signal is
+    // destroyed, while Connections may still refer to the table.
+    void clear()
+    {
+        container_type(m_slots.get_allocator()).swap(m_slots);
+        container_type(m_pending.get_allocator()).swap(m_pending);
+        priority_container(m_pendingPriorities.get_allocator()).swap(m_pendingPriorities);
+        band_container(m_bands.get_allocator()).swap(m_bands);
+        handle_container(m_handles.get_allocator()).swap(m_handles);
+        id_container(m_freeIds.get_allocator()).swap(m_freeIds);
+        id_container(m_released.get_allocator()).swap(m_released);
+        m_numDead = 0;
+        m_numFree = 0;
+        m_numLive = 0;
+        unregister();
+    }
+
+    std::size_t numDead() const { return m_numDead; }
+    std::size_t numLive() const { return m_numLive; }
+    SignalStats& stats() { return *this; }
+
+    // Names the signal in statistics and traces.
+    void setName(char const* name)
+    {
+        SignalStats::setName(name);
+        SignalTrace::setName(name);
+    }
+    bool deferring() const { return m_deferring != 0; }
+    container_type& slots() { return m_slots; }
+    container_type const& slots() const { return m_slots; }
+
+private:
+    struct Handle {
+        Handle(): index(0), generation(0) { }
+        std::size_t index;
+        unsigned generation;
+    };
+
+    // The slots of a priority are those in [end of previous band, end), of
+    // which those from top on are free.
+    struct Band {
+        int priority;
+        std::size_t top;
+        std::size_t end;
+    };
+
+    typedef typename std::allocator_traits<Allocator>::template
+        rebind_alloc<SlotTable> table_allocator;
+    typedef std::allocator_traits<table_allocator> table_traits;
+    typedef std::vector<Handle, typename std::allocator_traits<Allocator>::template
+        rebind_alloc<Handle>> handle_container;
+    typedef std::vector<id_type, typename std::allocator_traits<Allocator>::template
+        rebind_alloc<id_type>> id_container;
+    typedef std::vector<int, typename std::allocator_traits<Allocator>::template
+        rebind_alloc<int>> priority_container;
+    typedef std::vector<Band, typename std::allocator_traits<Allocator>::template
+        rebind_alloc<Band>> band_container;
+
+    template <typename Alloc>
+    explicit SlotTable(Alloc const& alloc):
+        m_slots(alloc), m_pending(alloc), m_pendingPriorities(alloc), m_bands(alloc),
+        m_handles(alloc), m_freeIds(alloc), m_released(alloc),
+        m_numDead(0), m_numFree(0), m_numLive(0), m_compactionThreshold(0.25f),
+        m_deferring(0),
+        m_calling(false), m_refs(0)
+    {
+    }
+
+    // Releases the slots disconnected while deferring. Slots which have been
+    // moved in the meantime, e.g. by a connect() from a released slot's
+    // destructor, are released by compaction instead.
+    void releaseDisconnected()
+    {
+        while (!m_released.empty()) {
+            std::size_t const index = m_released.back();
+            m_released.pop_back();
+            if (index >= m_slots.size() + m_pending.size())
+                continue;
+            Slot& s = index < m_slots.size() ?
+                m_slots[index] : m_pending[index - m_slots.size()];
+            if (s.id == invalidId)
+                releaseSlot(s.function);
+        }
+    }
+
+    void flushPending()
+    {
+        for (std::size_t i = 0; i < m_pending.size(); ++i)
+            insert(std::move(m_pending[i]), m_pendingPriorities[i]);
+        m_pending.clear();
+        m_pendingPriorities.clear();
+    }
+
+    // Inserts s as the first slot to be called of its priority's band. The
+    // last band grows at the end of the array. Other bands keep free slots
+    // behind their occupied ones, which are filled in order; when none are
+    // left, as many as the band has slots are inserted at once, moving the
+    // slots behind the band. Without free slots, i.e. if Function is not
+    // default constructible, they are moved for every slot inserted.
+    void insert(Slot&& s, int priority)
+    {
+        if (m_bands.empty()) {
+            if (priority == 0) {
+                place(std::move(s));
+                return;
+            }
+            Band const all = { 0, m_slots.size(), m_slots.size() };
+            m_bands.push_back(all);
+        }
+        auto band = m_bands.begin();
+        while (band != m_bands.end() && band->priority > priority)
+            ++band;
+        if (band == m_bands.end() || band->priority != priority) {
+            std::size_t const begin = band == m_bands.begin() ? 0 : (band - 1)->end;
+            Band const created = { priority, begin, begin };
+            band = m_bands.insert(band, created);
+        }
+
+        if (band + 1 == m_bands.end()) {
+            place(std::move(s));
+            band->top = band->end = m_slots.size();
+            return;
+        }
+        if (band->top == band->end && !grow(band, std::is_default_constructible<Function>())) {
+            place(std::move(s));
+            moveIntoBand(band, 1);
+            ++band->top;
+            return;
+        }
+        Slot& target = m_slots[band->top];
+        target = std::move(s);
+        if (target.id != invalidId)
+            m_handles[target.id].index = band->top;
+        ++band->top;
+        --m_numFree;
+    }
+
+    // Adds free slots to band, as many as it has slots but at least 4.
+    bool grow(typename band_container::iterator band, std::true_type)
+    {
+        std::size_t const begin = band == m_bands.begin() ? 0 : (band - 1)->end;
+        std::size_t const count = std::max<std::size_t>(band->end - begin, 4);
+        m_slots.reserve(m_slots.size() + count);
+        for (std::size_t i = 0; i < count; ++i)
+            m_slots.push_back(Slot(invalidId));
+        moveIntoBand(band, count);
+        m_numFree += count;
+        return true;
+    }
+
+    bool grow(typename band_container::iterator, std::false_type) { return false; }
+
+    // Moves the last count slots of the array to the end of band, in front
+    // of the bands behind it.
+    void moveIntoBand(typename band_container::iterator band, std::size_t count)
+    {
+        std::rotate(m_slots.begin() + band->end, m_slots.end() - count, m_slots.end());
+        for (std::size_t i = band->end; i < m_slots.size(); ++i) {
+            if (m_slots[i].id != invalidId)
+                m_handles[m_slots[i].id].index = i;
+        }
+        band->end += count;
+        for (auto it = band + 1; it != m_bands.end(); ++it) {
+            it->top += count;
+            it->end += count;
+        }
+    }
+
+    // Appends s to the array and returns its index.
+    std::size_t place(Slot&& s)
+    {
+        m_slots.push_back(std::move(s));
+        std::size_t const index = m_slots.size() - 1;
+        if (m_slots[index].id != invalidId)
+            m_handles[m_slots[index].id].index = index;
+        return index;
+    }
+
+    container_type m_slots;
+    container_type m_pending; // connected while deferring
+    priority_container m_pendingPriorities; // of the slots in m_pending
+    band_container m_bands; // empty if all slots have priority 0
+    handle_container m_handles; // indexed by id
+    id_container m_freeIds;
+    id_container m_released; // indices of slots disconnected while deferring
+    std::size_t m_numDead;
+    std::size_t m_numFree; // in front of the last band
+    std::size_t m_numLive; // including pending slots
+    float m_compactionThreshold;
+    unsigned m_deferring;
+    bool m_calling;
+    typename Threading::counter_type m_refs;
+
+    SlotTable(SlotTable const&);
+    SlotTable& operator=(SlotTable const&);
+};
+
+// Calls the slots of a table for a range of events, each of which is a
+// tuple of arguments. The iteration is slot-major: each slot is called for
+// all events, in order, before the next slot is called.
+template <typename... Args>
+struct BatchInvoker {
+    template <typename Table, typename ForwardIterator>
+    static void invoke(Table& table, ForwardIterator first, ForwardIterator last)
+    {
+        if (first == last)
+            return;
+        typename Table::Deferral deferral(table);
+        auto& slots = table.slots();
+        // Slots are called in reverse order of connection.
+        for (std::size_t i = slots.size(); i-- > 0; ) {
+            for (ForwardIterator it = first; it != last; ++it) {
+                // The slot may disconnect itself in the middle of the batch.
+                if (slots[i].id == Table::invalidId)
+                    break;
+                typename Table::SlotCall probe(table, slots[i].id);
+                call(slots[i].function, *it);
+            }
+        }
+    }
+
+private:
+    typedef typename MakeIndexSequence<sizeof...(Args)>::type indices;
+    typedef std::tuple<typename std::decay<Args>::type...> tuple_type;
+
+    // Events are tuples of the arguments or, for signals with a single
+    // parameter, the argument itself.
+    template <typename Function, typename Event>
+    static void call(Function& slot, Event& event)
+    {
+        call(slot, event, std::is_same<typename std::remove_const<Event>::type, tuple_type>(),
+             indices());
+    }
+
+    template <typename Function, typename Event, std::size_t... Is>
+    static void call(Function& slot, Event& event, std::true_type, IndexSequence<Is...>)
+    {
+        slot(BatchArg<Args>::get(std::get<Is>(event))...);
+    }
+
+    template <typename Function, typename Event, typename Indices>
+    static void call(Function& slot, Event& event, std::false_type, Indices)
+    {
+        slot(BatchArg<Args...>::get(event));
+    }
+};
+
 } // namespace detail
 
 class ConnectionBase
@@ -64,32 +985,212 @@ public:
 };
 
 
-template<class Signature>
+// Owns connections of any signatures, e.g. all connections of an object to
+// signals of other objects, and disconnects them together when destroyed.
+// The connections are stored in one array, without virtual calls or
+// reference counted control blocks of their own.
+class ConnectionGroup
+{
+public:
+    ConnectionGroup() { }
+    ConnectionGroup(ConnectionGroup&& rhs): m_entries(std::move(rhs.m_entries)) { }
+    ConnectionGroup& operator=(ConnectionGroup&& rhs)
+    {
+        disconnectAll();
+        m_entries.swap(rhs.m_entries);
+        return *this;
+    }
+
+    ~ConnectionGroup() { disconnectAll(); }
+
+    // Adds a connection which is disconnected together with the group. The
+    // passed connection object stays valid and may be used to disconnect the
+    // slot earlier.
+    template <typename Connection>
+    void add(Connection const& connection)
+    {
+        if (!connection.isConnected())
+            return;
+        if (m_entries.size() == m_entries.capacity())
+            removeDisconnected();
+        typedef typename Connection::table_type table_type;
+        table_type* const table = connection.m_table.get();
+        intrusive_ptr_add_ref(table);
+        Entry const entry = {
+            table, connection.m_id, connection.m_generation,
+            &isConnected<table_type>, &release<table_type> };
+        m_entries.push_back(entry);
+    }
+
+    // Disconnects all connections of the group in one pass and removes them
+    // from the group.
+    void disconnectAll()
+    {
+        // Destroying a slot may add connections to the group again.
+        std::vector<Entry> entries;
+        entries.swap(m_entries);
+        for (auto const& entry: entries)
+            entry.release(entry, true);
+        entries.clear();
+        if (m_entries.empty())
+            m_entries.swap(entries); // keep the capacity
+    }
+
+    // Number of connections added, including connections which have been
+    // disconnected individually but not yet been removed from the group.
+    std::size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+private:
+    struct Entry {
+        void* table;
+        std::size_t id;
+        unsigned generation;
+        bool (*isConnected)(Entry const&);
+        void (*release)(Entry const&, bool disconnect); // drops the table reference
+    };
+
+    template <typename Table>
+    static bool isConnected(Entry const& entry)
+    {
+        return static_cast<Table*>(entry.table)->isConnected(entry.id, entry.generation);
+    }
+
+    template <typename Table>
+    static void release(Entry const& entry, bool disconnect)
+    {
+        Table* const table = static_cast<Table*>(entry.table);
+        if (disconnect && table->isConnected(entry.id, entry.generation))
+            table->disconnect(entry.id);
+        intrusive_ptr_release(table);
+    }
+
+    // Called before the array grows, so that groups whose connections are
+    // mostly disconnected individually do not grow without bounds.
+    void removeDisconnected()
+    {
+        auto out = m_entries.begin();
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+            if (it->isConnected(*it))
+                *out++ = *it;
+            else
+                it->release(*it, false);
+        }
+        m_entries.erase(out, m_entries.end());
+    }
+
+    std::vector<Entry> m_entries;
+
+    ConnectionGroup(ConnectionGroup const&);
+    ConnectionGroup& operator=(ConnectionGroup const&);
+};
+
+
+// Base class for receivers whose slots are disconnected automatically when
+// they are destroyed: slots connected with Signal::connect(receiver, slot)
+// are retired eagerly by ~Trackable(), so that invoking a signal does not
+// need to check whether the receivers are still alive.
+//
+// Slots are disconnected only after the destructors of derived classes have
+// run. Call disconnectTracked() in the derived destructor if signals may be
+// invoked in the meantime, e.g. by destroying members.
+class Trackable
+{
+public:
+    // Disconnects all slots tracking this object.
+    void disconnectTracked() { m_tracked.disconnectAll(); }
+
+    ConnectionGroup& trackedConnections() { return m_tracked; }
+
+protected:
+    Trackable() { }
+
+    // Connections are not copied: each object tracks its own slots.
+    Trackable(Trackable const&) { }
+    Trackable& operator=(Trackable const&) { return *this; }
+
+    ~Trackable() { }
+
+private:
+    ConnectionGroup m_tracked;
+};
+
+
+template<class Signature,
+         class Function = boost::function<Signature>,
+         class Allocator = std::allocator<void>,
+         class Threading = SingleThreaded>
 class Signal;
 
-template<class Signature>
+template<class Signature,
+         class Function = boost::function<Signature>,
+         class Allocator = std::allocator<void>,
+         class Threading = SingleThreaded>
 class Connection;
 
-template<class Signature>
+template<class Signature,
+         class Function = boost::function<Signature>,
+         class Allocator = std::allocator<void>,
+         class Threading = SingleThreaded>
 class ScopedConnection;
 
-#define BOOST_PP_ITERATION_LIMITS (0, SSIG_MAX_ARGS)
-#define BOOST_PP_FILENAME_1 "ssig_template.hpp"
-#include BOOST_PP_ITERATE()
+template<class Signature,
+         class Function = boost::function<Signature>,
+         class Allocator = std::allocator<void>,
+         class Threading = SingleThreaded>
+class CompactSignal;
+
+template<class Signature, Signature*... Slots>
+class StaticSignal;
+
+template<class Signature,
+         class Function = boost::function<Signature>,
+         class Allocator = std::allocator<void>,
+         class Threading = SingleThreaded>
+class QueuedSignal;
+
+// A signal whose slots are all of the same type F, e.g. a handler struct or
+// a MemberSlot. The slots are stored by value in the slot array and called
+// directly, without the indirection of boost::function, so that they can be
+// inlined. F must be move constructible and move assignable (which lambdas
+// are not).
+template<class Signature,
+         class F,
+         class Allocator = std::allocator<void>,
+         class Threading = SingleThreaded>
+using TypedSignal = Signal<Signature, F, Allocator, Threading>;
 
-#undef TYPES
-#undef TMPL_PARAMS
-#undef TRAILING_TMPL_PARAMS
+// A slot calling the member function Method of an object, for a
+// TypedSignal, e.g. TypedSignal<void(int), MemberSlot<Widget, void(int),
+// &Widget::resize>>.
+template <typename T, typename Signature, Signature T::*Method>
+class MemberSlot {
+public:
+    explicit MemberSlot(T& object): m_object(&object) { }
 
-#undef TYPED_ARGS
-#undef TRAILING_TYPED_ARGS
-#undef ARGS
+    template <typename... AF>
+    auto operator() (AF&&... args) const
+        -> decltype((std::declval<T&>().*Method)(std::forward<AF>(args)...))
+    {
+        return (m_object->*Method)(std::forward<AF>(args)...);
+    }
 
-#undef PRINT_RREF_ARG
-#undef TYPED_RREF_ARGS
-#undef RREF_TMPL
-#undef PRINT_FORWARD_ARG
-#undef TRAILING_FWD_ARGS
+    T& object() const { return *m_object; }
+
+private:
+    T* m_object;
+};
+
+template<class Key,
+         class Signature,
+         class Function = boost::function<Signature>,
+         class Allocator = std::allocator<void>,
+         class Threading = SingleThreaded,
+         class Hash = std::hash<Key>,
+         class KeyEqual = std::equal_to<Key>>
+class KeyedSignal;
+
+#include "ssig_template.hpp"
 
 #define SSIG_DEFINE_MEMBERSIGNAL(name, signature) \
     public:                                                            \
@@ -98,7 +1199,17 @@ class ScopedConnection;
         {                                                              \
             return m_sig_##name.connect(slot);                         \
         }                                                              \
-    private: ssig::Signal<signature> m_sig_##name;
+    private: ssig::Signal<signature> m_sig_##name{#name};
+
+
+#define SSIG_DEFINE_COMPACT_MEMBERSIGNAL(name, signature) \
+    public:                                                                   \
+        ssig::CompactSignal<signature>::connection_type const connect_##name( \
+            ssig::CompactSignal<signature>::function_type const& slot)        \
+        {                                                                     \
+            return m_sig_##name.connect(slot);                                \
+        }                                                                     \
+    private: ssig::CompactSignal<signature> m_sig_##name{#name};
 
 
 #define SSIG_DEFINE_STATICSIGNAL(name, signature) \
@@ -111,7 +1222,22 @@ class ScopedConnection;
     private:                                                                  \
         static ssig::Signal<signature>& sig_##name()                          \
         {                                                                     \
-            static ssig::Signal<signature> sig;                               \
+            static ssig::Signal<signature> sig(#name);                        \
+            return sig;                                                       \
+        }
+
+
+#define SSIG_DEFINE_FIXEDSIGNAL(name, signature, ...) \
+    public:                                                                   \
+        static ssig::Signal<signature>::connection_type const connect_##name( \
+            ssig::Signal<signature>::function_type const& slot)               \
+        {                                                                     \
+            return sig_##name().connect(slot);                                \
+        }                                                                     \
+    private:                                                                  \
+        static ssig::StaticSignal<signature, __VA_ARGS__>& sig_##name()       \
+        {                                                                     \
+            static ssig::StaticSignal<signature, __VA_ARGS__> sig(#name);     \
             return sig;                                                       \
         }
 
@@ -0,0 +1,322 @@
+// Part of ssig -- Copyright (c) Christian Neumller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+#ifndef SSIG_CONCURRENT_HPP_INCLUDED
+#define SSIG_CONCURRENT_HPP_INCLUDED SSIG_CONCURRENT_HPP_INCLUDED
+
+#include "ssig.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace ssig {
+
+template<class Signature, class Function = boost::function<Signature>>
+class ConcurrentSignal;
+
+template<class Signature, class Function = boost::function<Signature>>
+class ConcurrentConnection;
+
+namespace detail {
+
+// Epoch based reclamation for the slot snapshots of ConcurrentSignals.
+// While a thread emits a signal, it announces the global epoch it observed
+// when it started. A snapshot which was replaced in epoch e is freed as soon
+// as no thread announces e or an earlier epoch anymore.
+class EpochDomain {
+public:
+    typedef std::uint64_t epoch_type;
+
+    struct Record {
+        Record(): epoch(0), inUse(true), nesting(0), next(nullptr) { }
+        std::atomic<epoch_type> epoch; // 0 if the thread is not emitting
+        std::atomic<bool> inUse;
+        unsigned nesting; // only accessed by the owning thread
+        Record* next;
+    };
+
+    class Guard {
+    public:
+        Guard(): m_record(instance().threadRecord())
+        {
+            if (m_record.nesting++ == 0)
+                m_record.epoch.store(instance().m_epoch.load());
+        }
+
+        ~Guard()
+        {
+            if (--m_record.nesting == 0)
+                m_record.epoch.store(0, std::memory_order_release);
+        }
+
+    private:
+        Record& m_record;
+
+        Guard(Guard const&);
+        Guard& operator=(Guard const&);
+    };
+
+    static EpochDomain& instance()
+    {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    // Starts a new epoch and returns the previous one.
+    epoch_type advance() { return m_epoch.fetch_add(1); }
+
+    // Returns the oldest epoch announced by any thread.
+    epoch_type oldestAnnounced() const
+    {
+        epoch_type oldest = std::numeric_limits<epoch_type>::max();
+        for (Record* r = m_records.load(); r; r = r->next) {
+            epoch_type const epoch = r->epoch.load();
+            if (epoch && epoch < oldest)
+                oldest = epoch;
+        }
+        return oldest;
+    }
+
+private:
+    struct RecordOwner {
+        RecordOwner(EpochDomain& domain): record(domain.acquireRecord()) { }
+        ~RecordOwner() { record->inUse.store(false, std::memory_order_release); }
+        Record* record;
+    };
+
+    EpochDomain(): m_epoch(1), m_records(nullptr) { }
+
+    Record& threadRecord()
+    {
+        static thread_local RecordOwner owner(*this);
+        return *owner.record;
+    }
+
+    // Records are never freed but reused after their thread has exited.
+    Record* acquireRecord()
+    {
+        for (Record* r = m_records.load(); r; r = r->next) {
+            bool expected = false;
+            if (!r->inUse.load(std::memory_order_relaxed)
+                    && r->inUse.compare_exchange_strong(expected, true))
+                return r;
+        }
+        Record* const r = new Record;
+        r->next = m_records.load();
+        while (!m_records.compare_exchange_weak(r->next, r))
+            ;
+        return r;
+    }
+
+    std::atomic<epoch_type> m_epoch;
+    std::atomic<Record*> m_records;
+};
+
+// The slots of a ConcurrentSignal. Emitters read an immutable snapshot of the
+// slot list without locking; connect() and disconnect() copy the current
+// snapshot under a mutex, modify the copy and publish it.
+template <typename Function>
+class ConcurrentSlots {
+public:
+    struct Slot {
+        explicit Slot(Function const& function): function(function), connected(true) { }
+        Function const function;
+        std::atomic<bool> connected;
+    };
+
+    typedef std::vector<std::shared_ptr<Slot>> snapshot_type;
+
+    ConcurrentSlots(): m_current(new snapshot_type) { }
+
+    ~ConcurrentSlots()
+    {
+        delete m_current.load();
+        for (auto const& retired: m_retired)
+            delete retired.snapshot;
+    }
+
+    // Must only be called, and the result used, while an EpochDomain::Guard
+    // exists.
+    snapshot_type const& current() const { return *m_current.load(); }
+
+    std::shared_ptr<Slot> connect(Function const& function)
+    {
+        auto const slot = std::make_shared<Slot>(function);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::unique_ptr<snapshot_type> snapshot(new snapshot_type(*m_current.load()));
+        snapshot->push_back(slot);
+        publish(snapshot.release());
+        return slot;
+    }
+
+    void disconnect(Slot& slot)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!slot.connected.exchange(false))
+            return;
+        snapshot_type const& current = *m_current.load();
+        std::unique_ptr<snapshot_type> snapshot(new snapshot_type);
+        snapshot->reserve(current.size() - 1);
+        for (auto const& s: current) {
+            if (s.get() != &slot)
+                snapshot->push_back(s);
+        }
+        publish(snapshot.release());
+    }
+
+private:
+    struct Retired {
+        snapshot_type* snapshot;
+        EpochDomain::epoch_type epoch;
+    };
+
+    void publish(snapshot_type* snapshot)
+    {
+        EpochDomain& domain = EpochDomain::instance();
+        Retired const retired = { m_current.exchange(snapshot), domain.advance() };
+        m_retired.push_back(retired);
+
+        EpochDomain::epoch_type const oldest = domain.oldestAnnounced();
+        auto out = m_retired.begin();
+        for (auto it = m_retired.begin(); it != m_retired.end(); ++it) {
+            if (it->epoch < oldest)
+                delete it->snapshot;
+            else
+                *out++ = *it;
+        }
+        m_retired.erase(out, m_retired.end());
+    }
+
+    std::atomic<snapshot_type*> m_current;
+    std::mutex m_mutex; // serializes writers
+    std::vector<Retired> m_retired;
+
+    ConcurrentSlots(ConcurrentSlots const&);
+    ConcurrentSlots& operator=(ConcurrentSlots const&);
+};
+
+template <typename R>
+struct ConcurrentInvoker {
+    template <typename Snapshot, typename... Args>
+    static R invoke(Snapshot const& slots, Args&&... args)
+    {
+        std::size_t i = slots.size();
+        do {
+            if (i == 0)
+                throw SsigError("attempt to invoke empty signal with non-void return type");
+        } while (!slots[--i]->connected.load(std::memory_order_relaxed));
+        for (;;) {
+            R r(slots[i]->function(std::forward<Args>(args)...));
+            do {
+                if (i == 0)
+                    return r; // return last result
+            } while (!slots[--i]->connected.load(std::memory_order_relaxed));
+        }
+    }
+};
+
+template <>
+struct ConcurrentInvoker<void> {
+    template <typename Snapshot, typename... Args>
+    static void invoke(Snapshot const& slots, Args&&... args)
+    {
+        for (std::size_t i = slots.size(); i-- > 0; ) {
+            if (slots[i]->connected.load(std::memory_order_relaxed))
+                slots[i]->function(std::forward<Args>(args)...);
+        }
+    }
+};
+
+} // namespace detail
+
+// A Signal which can be emitted, connected to and disconnected from by
+// multiple threads concurrently. Emission never blocks.
+template<typename R, typename... Args, typename Function>
+class ConcurrentSignal<R(Args...), Function> {
+public:
+    typedef Function function_type;
+    typedef ConcurrentConnection<R(Args...), Function> connection_type;
+
+    ConcurrentSignal(): m_slots(std::make_shared<slots_type>()) { }
+
+    R const operator() (typename detail::ParamType<Args>::type... args)
+    {
+        detail::EpochDomain::Guard guard;
+        return detail::ConcurrentInvoker<R>::invoke(m_slots->current(),
+            detail::slotArg<Args>(args)...);
+    }
+
+    connection_type connect(function_type const& slot)
+    {
+        return connection_type(*this, slot);
+    }
+
+    bool empty() const
+    {
+        detail::EpochDomain::Guard guard;
+        return m_slots->current().empty();
+    }
+
+private:
+    friend connection_type;
+    typedef detail::ConcurrentSlots<Function> slots_type;
+
+    std::shared_ptr<slots_type> m_slots;
+
+    ConcurrentSignal(ConcurrentSignal const&);
+    ConcurrentSignal& operator=(ConcurrentSignal const&);
+};
+
+template<typename R, typename... Args, typename Function>
+class ConcurrentConnection<R(Args...), Function>: public ConnectionBase {
+public:
+    typedef ConcurrentSignal<R(Args...), Function> signal_type;
+
+    ConcurrentConnection() { } // construct disconnected connection
+
+    ConcurrentConnection(signal_type& signal, Function const& slot)
+    {
+        if (detail::isEmptySlot(slot))
+            return;
+        m_slots = signal.m_slots;
+        m_slot = signal.m_slots->connect(slot);
+    }
+
+    bool isConnected() const
+    {
+        auto const slot = m_slot.lock();
+        return slot && slot->connected.load(std::memory_order_acquire);
+    }
+
+    void disconnect()
+    {
+        auto const slots = m_slots.lock();
+        auto const slot = m_slot.lock();
+        if (!slots || !slot || !slot->connected.load())
+            throw SsigError("attempt to use a disconnected signal");
+        slots->disconnect(*slot);
+    }
+
+    R invokeSlot(typename detail::ParamType<Args>::type... args)
+    {
+        auto const slot = m_slot.lock();
+        if (!slot || !slot->connected.load())
+            throw SsigError("attempt to use a disconnected signal");
+        return slot->function(detail::slotArg<Args>(args)...);
+    }
+
+private:
+    typedef typename signal_type::slots_type slots_type;
+
+    std::weak_ptr<slots_type> m_slots;
+    std::weak_ptr<typename slots_type::Slot> m_slot;
+};
+
+} // namespace ssig
+#endif
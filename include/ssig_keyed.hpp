@@ -0,0 +1,247 @@
+// Part of ssig -- Copyright (c) Christian Neumller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+#ifndef SSIG_KEYED_HPP_INCLUDED
+#define SSIG_KEYED_HPP_INCLUDED SSIG_KEYED_HPP_INCLUDED
+
+#include "ssig.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+
+namespace ssig {
+
+// A signal whose first argument is a key, e.g. an entity id or a message
+// type, and whose slots are connected for a single key (or for all keys).
+// Invoking it calls only the slots connected for the key of the invocation,
+// followed by the slots connected for all keys: the slots of each key are
+// kept in a slot table of their own, which is looked up in a flat hash
+// table. Connections are ordinary Connections. Like the unordered
+// containers, the signal stores a Hash and a KeyEqual object.
+template<typename Key, typename R, typename A0, typename... Args,
+         typename Function, typename Allocator, typename Threading,
+         typename Hash, typename KeyEqual>
+class KeyedSignal<Key, R(A0, Args...), Function, Allocator, Threading, Hash, KeyEqual> {
+    static_assert(std::is_same<typename std::decay<A0>::type, Key>::value,
+        "the first parameter of the signature must be the key");
+public:
+    typedef Function function_type;
+    typedef Key key_type;
+    typedef Connection<R(A0, Args...), Function, Allocator, Threading> connection_type;
+
+    explicit KeyedSignal(Allocator const& alloc = Allocator()):
+        m_any(table_type::create(alloc)),
+        m_buckets(alloc),
+        m_numUsed(0),
+        m_shift(0),
+        m_name(nullptr),
+        m_alloc(alloc)
+    {
+    }
+
+    explicit KeyedSignal(Hash const& hash, KeyEqual const& equal = KeyEqual(),
+                         Allocator const& alloc = Allocator()):
+        m_any(table_type::create(alloc)),
+        m_buckets(alloc),
+        m_numUsed(0),
+        m_shift(0),
+        m_name(nullptr),
+        m_alloc(alloc),
+        m_hash(hash),
+        m_equal(equal)
+    {
+    }
+
+    ~KeyedSignal()
+    {
+        m_any->clear();
+        for (auto& bucket: m_buckets) {
+            if (bucket.table)
+                bucket.table->clear();
+        }
+    }
+
+    // Calls the slots connected for key, then the ones connected for all
+    // keys, each in the order of Signal::operator(). Returns the result of
+    // the slot called last; for non-void return types, a SsigError is
+    // thrown if no slot is called. Like a Signal, the keyed signal as a whole
+    // must not be invoked recursively, whatever the key; the invocation is
+    // recorded in statistics and traces once, as one of the slots for all
+    // keys.
+    R const operator() (typename detail::ParamType<A0>::type key,
+                        typename detail::ParamType<Args>::type... args)
+    {
+        typename table_type::Emission const emission(*m_any);
+        // Keep the table alive: a slot may disconnect all slots of key and
+        // connect slots for other keys, which may drop it from the buckets.
+        boost::intrusive_ptr<table_type> const keyed(find(key));
+        auto const invoke = [&](table_type& table) -> R {
+            TableRef const ref = { &table };
+            return detail::SignalInvoker<R(A0, Args...)>::invoke(ref,
+                detail::slotArg<A0>(key),
+                detail::slotArg<Args>(args)...);
+        };
+        if (keyed && keyed->numLive() != 0) {
+            keyed->compactIfNeeded();
+            if (m_any->numLive() == 0)
+                return invoke(*keyed);
+            invoke(*keyed);
+        }
+        return invoke(*m_any);
+    }
+
+    // Connects a slot which is only called for key.
+    connection_type connect(key_type const& key, function_type const& slot)
+    {
+        connection_type connection;
+        connection.connect(tableFor(key), slot);
+        return connection;
+    }
+
+    // Connects a slot which is called for every key.
+    connection_type connectAny(function_type const& slot)
+    {
+        connection_type connection;
+        connection.connect(m_any, slot);
+        return connection;
+    }
+
+    // Number of slots connected for key, not counting those connected for
+    // all keys.
+    std::size_t count(key_type const& key) const
+    {
+        table_type const* const table = find(key);
+        return table ? table->numLive() : 0;
+    }
+
+    bool empty() const
+    {
+        if (m_any->numLive() != 0)
+            return false;
+        for (auto const& bucket: m_buckets) {
+            if (bucket.table && bucket.table->numLive() != 0)
+                return false;
+        }
+        return true;
+    }
+
+    // See Signal::setName().
+    void setName(char const* name)
+    {
+        m_name = name;
+        m_any->setName(name);
+        for (auto& bucket: m_buckets) {
+            if (bucket.table)
+                bucket.table->setName(name);
+        }
+    }
+
+private:
+    typedef detail::SlotTable<Function, Allocator, Threading> table_type;
+
+    // What detail::SignalInvoker needs of a signal.
+    struct TableRef {
+        typedef detail::SlotTable<Function, Allocator, Threading> table_type;
+        table_type* m_slots;
+    };
+
+    // An empty bucket has no table. The tables of keys without slots are
+    // dropped when the buckets are rehashed.
+    struct Bucket {
+        Bucket(): key(), table() { }
+        Key key;
+        boost::intrusive_ptr<table_type> table;
+    };
+
+    typedef std::vector<Bucket, typename std::allocator_traits<Allocator>::template
+        rebind_alloc<Bucket>> bucket_container;
+
+    // Maps the hash of key to the buckets by Fibonacci hashing: the hash is
+    // multiplied by 2^N / phi and the top bits are taken, so that hashes
+    // which differ only in their high bits, e.g. strided ids or pointers
+    // under the identity hash of libstdc++, still spread over all buckets.
+    std::size_t bucketFor(key_type const& key, unsigned shift) const
+    {
+        std::size_t const factor = static_cast<std::size_t>(
+            sizeof(std::size_t) > 4 ? 0x9E3779B97F4A7C15ull : 0x9E3779B9ull);
+        return (m_hash(key) * factor) >> shift;
+    }
+
+    table_type* find(key_type const& key) const
+    {
+        if (m_buckets.empty())
+            return nullptr;
+        std::size_t const mask = m_buckets.size() - 1;
+        for (std::size_t i = bucketFor(key, m_shift); m_buckets[i].table; i = (i + 1) & mask) {
+            if (m_equal(m_buckets[i].key, key))
+                return m_buckets[i].table.get();
+        }
+        return nullptr;
+    }
+
+    boost::intrusive_ptr<table_type> const& tableFor(key_type const& key)
+    {
+        // Keep the load factor at most 3/4.
+        if (4 * (m_numUsed + 1) > 3 * m_buckets.size())
+            rehash();
+        std::size_t const mask = m_buckets.size() - 1;
+        std::size_t i = bucketFor(key, m_shift);
+        for (; m_buckets[i].table; i = (i + 1) & mask) {
+            if (m_equal(m_buckets[i].key, key))
+                return m_buckets[i].table;
+        }
+        m_buckets[i].key = key;
+        m_buckets[i].table = table_type::create(m_alloc);
+        m_buckets[i].table->setName(m_name);
+        ++m_numUsed;
+        return m_buckets[i].table;
+    }
+
+    // Drops the tables without slots and grows the buckets if necessary.
+    void rehash()
+    {
+        std::size_t numLive = 0;
+        for (auto const& bucket: m_buckets) {
+            if (bucket.table && bucket.table->numLive() != 0)
+                ++numLive;
+        }
+        std::size_t size = 16;
+        unsigned shift = 8 * sizeof(std::size_t) - 4;
+        while (4 * (numLive + 1) > 3 * size / 2) { // leave room to grow
+            size *= 2;
+            --shift;
+        }
+        bucket_container buckets(size, Bucket(), m_buckets.get_allocator());
+        for (auto& bucket: m_buckets) {
+            if (!bucket.table || bucket.table->numLive() == 0)
+                continue;
+            std::size_t i = bucketFor(bucket.key, shift);
+            while (buckets[i].table)
+                i = (i + 1) & (size - 1);
+            buckets[i].key = std::move(bucket.key);
+            buckets[i].table = std::move(bucket.table);
+        }
+        m_buckets.swap(buckets);
+        m_numUsed = numLive;
+        m_shift = shift;
+    }
+
+    boost::intrusive_ptr<table_type> m_any; // slots connected for all keys
+    bucket_container m_buckets; // size is 0 or a power of two
+    std::size_t m_numUsed;
+    unsigned m_shift; // bits of a size_t minus log2 of the number of buckets
+    char const* m_name;
+    Allocator m_alloc; // for new tables
+    Hash m_hash;
+    KeyEqual m_equal;
+
+    KeyedSignal(KeyedSignal const&);
+    KeyedSignal& operator=(KeyedSignal const&);
+};
+
+} // namespace ssig
+#endif
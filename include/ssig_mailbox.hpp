@@ -0,0 +1,244 @@
+// Part of ssig -- Copyright (c) Christian Neumller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+#ifndef SSIG_MAILBOX_HPP_INCLUDED
+#define SSIG_MAILBOX_HPP_INCLUDED SSIG_MAILBOX_HPP_INCLUDED
+
+#include "ssig.hpp"
+
+#ifndef SSIG_MAILBOX_MESSAGE_SIZE
+#   define SSIG_MAILBOX_MESSAGE_SIZE (8 * sizeof(void*))
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+
+namespace ssig {
+
+// A bounded queue of invocations which are run by the thread calling pump(),
+// e.g. the render or IO thread. Any number of threads may post invocations
+// concurrently without locking; only one thread at a time may call pump().
+class Mailbox {
+public:
+    static std::size_t const message_size = SSIG_MAILBOX_MESSAGE_SIZE;
+
+    // The capacity is rounded up to a power of two.
+    explicit Mailbox(std::size_t capacity = 1024):
+        m_mask(roundUpToPowerOfTwo(capacity) - 1),
+        m_cells(new Cell[m_mask + 1]),
+        m_head(0),
+        m_tail(0)
+    {
+        for (std::size_t i = 0; i <= m_mask; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Destroys pending invocations without running them.
+    ~Mailbox()
+    {
+        while (Cell* cell = readyCell()) {
+            Release release(*this, *cell);
+        }
+    }
+
+    // Constructs an invocation of type F from args in place and queues it.
+    // Returns false if the mailbox is full.
+    template <typename F, typename... CtorArgs>
+    bool tryEmplace(CtorArgs&&... args)
+    {
+        static_assert(sizeof(F) <= message_size,
+            "invocation does not fit into a Mailbox cell; increase SSIG_MAILBOX_MESSAGE_SIZE");
+        static_assert(std::alignment_of<F>::value
+                <= std::alignment_of<storage_type>::value,
+            "invocation is over-aligned for a Mailbox cell");
+
+        std::size_t pos = m_tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            std::size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t const diff =
+                static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return false; // the consumer has not freed this cell yet
+            } else {
+                pos = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+
+        try {
+            new (&cell->storage) F(std::forward<CtorArgs>(args)...);
+            cell->run = &runMessage<F>;
+            cell->destroy = &destroyMessage<F>;
+        } catch (...) {
+            // The cell is claimed already, so publish it as a no-op.
+            cell->run = nullptr;
+            cell->destroy = nullptr;
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            throw;
+        }
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // As tryEmplace(), but throws a SsigError if the mailbox is full.
+    template <typename F, typename... CtorArgs>
+    void emplace(CtorArgs&&... args)
+    {
+        if (!tryEmplace<F>(std::forward<CtorArgs>(args)...))
+            throw SsigError("mailbox is full");
+    }
+
+    template <typename F>
+    void post(F&& f)
+    {
+        emplace<typename std::decay<F>::type>(std::forward<F>(f));
+    }
+
+    // Runs pending invocations, in the order in which they were queued, until
+    // the mailbox is empty. Returns the number of invocations run.
+    std::size_t pump()
+    {
+        std::size_t n = 0;
+        while (Cell* cell = readyCell()) {
+            Release release(*this, *cell);
+            if (cell->run) {
+                cell->run(&cell->storage);
+                ++n;
+            }
+        }
+        return n;
+    }
+
+    std::size_t capacity() const { return m_mask + 1; }
+
+private:
+    typedef std::aligned_storage<message_size>::type storage_type;
+
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        void (*run)(void*);
+        void (*destroy)(void*);
+        storage_type storage;
+    };
+
+    // Destroys the invocation in a cell and hands the cell back to the
+    // producers, also if running the invocation throws.
+    struct Release {
+        Release(Mailbox& mailbox, Cell& cell): mailbox(mailbox), cell(cell) { }
+        ~Release()
+        {
+            if (cell.destroy)
+                cell.destroy(&cell.storage);
+            cell.sequence.store(mailbox.m_head + mailbox.m_mask + 1, std::memory_order_release);
+            ++mailbox.m_head;
+        }
+        Mailbox& mailbox;
+        Cell& cell;
+
+        Release& operator=(Release const&); // silence warning
+    };
+
+    static std::size_t roundUpToPowerOfTwo(std::size_t n)
+    {
+        std::size_t result = 1;
+        while (result < n)
+            result *= 2;
+        return result;
+    }
+
+    template <typename F>
+    static void runMessage(void* message) { (*static_cast<F*>(message))(); }
+
+    template <typename F>
+    static void destroyMessage(void* message) { static_cast<F*>(message)->~F(); }
+
+    // Returns the cell at the head of the queue if it has been published.
+    Cell* readyCell()
+    {
+        Cell& cell = m_cells[m_head & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_head + 1)
+            return nullptr;
+        return &cell;
+    }
+
+    std::size_t const m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+    char m_padding1[64];
+    std::size_t m_head; // only accessed by the consuming thread
+    char m_padding2[64];
+    std::atomic<std::size_t> m_tail;
+
+    Mailbox(Mailbox const&);
+    Mailbox& operator=(Mailbox const&);
+};
+
+namespace detail {
+
+// The invocation of a slot connected through an executor, together with
+// copies of the arguments.
+template <typename Function, typename... Args>
+class PostedInvocation {
+public:
+    template <typename... AF>
+    PostedInvocation(std::weak_ptr<Function> const& slot, AF&&... args):
+        m_slot(slot),
+        m_args(std::forward<AF>(args)...)
+    {
+    }
+
+    void operator() ()
+    {
+        // The slot is gone if it has been disconnected in the meantime.
+        if (auto const slot = m_slot.lock())
+            call(*slot, typename MakeIndexSequence<sizeof...(Args)>::type());
+    }
+
+private:
+    template <std::size_t... Is>
+    void call(Function& slot, IndexSequence<Is...>)
+    {
+        slot(slotArg<Args>(std::get<Is>(m_args))...);
+    }
+
+    std::weak_ptr<Function> m_slot;
+    std::tuple<typename std::decay<Args>::type...> m_args;
+};
+
+template <typename R, typename... Args, typename Function, typename Executor>
+class ExecutorSlot<R(Args...), Function, Executor> {
+    static_assert(std::is_void<R>::value,
+        "slots run by an executor cannot return a result");
+public:
+    ExecutorSlot(Executor& executor, Function const& slot):
+        m_executor(&executor),
+        m_slot(std::make_shared<Function>(slot))
+    {
+    }
+
+    template <typename... AF>
+    void operator() (AF&&... args) const
+    {
+        m_executor->template emplace<PostedInvocation<Function, Args...>>(
+            std::weak_ptr<Function>(m_slot), std::forward<AF>(args)...);
+    }
+
+private:
+    Executor* m_executor;
+    std::shared_ptr<Function> m_slot;
+};
+
+} // namespace detail
+
+} // namespace ssig
+#endif
@@ -0,0 +1,292 @@
+// Part of ssig -- Copyright (c) Christian Neumller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+#ifndef SSIG_PARALLEL_HPP_INCLUDED
+#define SSIG_PARALLEL_HPP_INCLUDED SSIG_PARALLEL_HPP_INCLUDED
+
+#include "ssig.hpp"
+
+#ifndef SSIG_PARALLEL_MIN_CHUNK_SIZE
+#   define SSIG_PARALLEL_MIN_CHUNK_SIZE 256
+#endif
+
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace ssig {
+
+// A work-stealing thread pool. parallelFor() distributes its tasks over the
+// queues of the worker threads; idle workers, and the thread waiting for the
+// tasks to finish, steal tasks from the queues of the others.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned numWorkers = defaultNumWorkers()):
+        m_numQueued(0),
+        m_stop(false),
+        m_nextQueue(0)
+    {
+        for (unsigned i = 0; i < numWorkers; ++i)
+            m_queues.emplace_back(new Queue);
+        try {
+            for (unsigned i = 0; i < numWorkers; ++i)
+                m_threads.emplace_back(&ThreadPool::work, this, i);
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    ~ThreadPool() { stop(); }
+
+    // Calls f(i) for all i in [0, n) concurrently and returns when all calls
+    // have returned. The calling thread takes part in the work. If any call
+    // throws, the first exception is rethrown.
+    template <typename F>
+    void parallelFor(std::size_t n, F const& f)
+    {
+        if (n == 0)
+            return;
+        if (m_queues.empty() || n == 1) {
+            for (std::size_t i = 0; i < n; ++i)
+                f(i);
+            return;
+        }
+
+        Batch batch(n);
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_numQueued += n;
+        }
+        std::size_t queue = m_nextQueue++;
+        for (std::size_t i = 0; i < n; ++i, ++queue) {
+            Task const task = { &runTask<F>, &f, i, &batch };
+            Queue& q = *m_queues[queue % m_queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            q.tasks.push_back(task);
+        }
+        m_wake.notify_all();
+
+        while (batch.remaining.load(std::memory_order_acquire) != 0) {
+            Task task;
+            if (steal(m_queues.size(), task))
+                task.batch->run(task);
+            else
+                std::this_thread::yield();
+        }
+        if (batch.error)
+            std::rethrow_exception(batch.error);
+    }
+
+    // Number of worker threads, not counting threads calling parallelFor().
+    std::size_t size() const { return m_threads.size(); }
+
+    static unsigned defaultNumWorkers()
+    {
+        unsigned const numCores = std::thread::hardware_concurrency();
+        return numCores > 1 ? numCores - 1 : 1;
+    }
+
+private:
+    struct Batch;
+
+    struct Task {
+        void (*run)(void const* f, std::size_t i);
+        void const* f;
+        std::size_t index;
+        Batch* batch;
+    };
+
+    struct Batch {
+        explicit Batch(std::size_t n): remaining(n) { }
+
+        void run(Task const& task)
+        {
+            try {
+                task.run(task.f, task.index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+            remaining.fetch_sub(1, std::memory_order_release);
+        }
+
+        std::atomic<std::size_t> remaining;
+        std::mutex mutex;
+        std::exception_ptr error;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    template <typename F>
+    static void runTask(void const* f, std::size_t i) { (*static_cast<F const*>(f))(i); }
+
+    // Takes a task from the back of the own queue (if self is a worker
+    // index) or from the front of another one.
+    bool steal(std::size_t self, Task& task)
+    {
+        if (m_numQueued.load(std::memory_order_acquire) == 0)
+            return false;
+        if (self < m_queues.size()) {
+            Queue& q = *m_queues[self];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = q.tasks.back();
+                q.tasks.pop_back();
+                --m_numQueued;
+                return true;
+            }
+        }
+        for (std::size_t i = 0; i < m_queues.size(); ++i) {
+            Queue& q = *m_queues[i];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (!q.tasks.empty()) {
+                task = q.tasks.front();
+                q.tasks.pop_front();
+                --m_numQueued;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void work(std::size_t self)
+    {
+        for (;;) {
+            Task task;
+            if (steal(self, task)) {
+                task.batch->run(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_wake.wait(lock, [this]() { return m_stop || m_numQueued.load() != 0; });
+            if (m_stop)
+                return;
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& t: m_threads)
+            t.join();
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues; // one per worker
+    std::vector<std::thread> m_threads;
+    std::atomic<std::size_t> m_numQueued;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_stop; // guarded by m_wakeMutex
+    std::atomic<std::size_t> m_nextQueue;
+
+    ThreadPool(ThreadPool const&);
+    ThreadPool& operator=(ThreadPool const&);
+};
+
+namespace detail {
+
+// Splits the slots of a signal into chunks which are called on a pool.
+// Chunk k holds the k-th block of slots in the order of a sequential
+// invocation, so that reducing the results of the chunks in chunk order
+// gives the same result as a sequential reduction.
+template <typename Pool>
+struct ParallelInvoker {
+    template <typename Table, typename Call>
+    static void invoke(Pool& pool, Table& table, Call const& call)
+    {
+        typename Table::Deferral deferral(table);
+        auto& slots = table.slots();
+        std::size_t const chunkSize = chunkSizeFor(pool, slots.size());
+        pool.parallelFor(numChunks(slots.size(), chunkSize), [&](std::size_t chunk) {
+            std::size_t const end = slots.size() - chunk * chunkSize;
+            std::size_t const begin = end > chunkSize ? end - chunkSize : 0;
+            std::size_t numCalled = 0;
+            for (std::size_t i = end; i-- > begin; ) {
+                if (slots[i].id != Table::invalidId) {
+                    call(slots[i].function);
+                    ++numCalled;
+                }
+            }
+            table.stats().slotsCalledConcurrently(numCalled);
+        });
+    }
+
+    template <typename R, typename Reduce, typename Table, typename Call>
+    static R reduce(Pool& pool, Table& table, Call const& call)
+    {
+        typename Table::Deferral deferral(table);
+        auto& slots = table.slots();
+        std::size_t const chunkSize = chunkSizeFor(pool, slots.size());
+        std::vector<boost::optional<R>> partials(numChunks(slots.size(), chunkSize));
+        pool.parallelFor(partials.size(), [&](std::size_t chunk) {
+            Reduce reduce;
+            boost::optional<R>& partial = partials[chunk];
+            std::size_t numCalled = 0;
+            std::size_t const end = slots.size() - chunk * chunkSize;
+            std::size_t const begin = end > chunkSize ? end - chunkSize : 0;
+            for (std::size_t i = end; i-- > begin; ) {
+                if (slots[i].id == Table::invalidId)
+                    continue;
+                ++numCalled;
+                if (partial)
+                    partial = reduce(*partial, call(slots[i].function));
+                else
+                    partial = call(slots[i].function);
+            }
+            table.stats().slotsCalledConcurrently(numCalled);
+        });
+
+        Reduce reduce;
+        boost::optional<R>* result = nullptr;
+        for (auto& partial: partials) {
+            if (!partial)
+                continue;
+            if (result)
+                *result = reduce(**result, *partial);
+            else
+                result = &partial;
+        }
+        if (!result)
+            throw SsigError("attempt to invoke empty signal with non-void return type");
+        return **result;
+    }
+
+private:
+    static std::size_t chunkSizeFor(Pool& pool, std::size_t numSlots)
+    {
+        // A few chunks per thread, so that stealing can balance the load.
+        std::size_t const numThreads = pool.size() + 1;
+        std::size_t const chunkSize = (numSlots + 4 * numThreads - 1) / (4 * numThreads);
+        return std::max<std::size_t>(chunkSize, SSIG_PARALLEL_MIN_CHUNK_SIZE);
+    }
+
+    static std::size_t numChunks(std::size_t numSlots, std::size_t chunkSize)
+    {
+        return (numSlots + chunkSize - 1) / chunkSize;
+    }
+};
+
+} // namespace detail
+
+} // namespace ssig
+#endif
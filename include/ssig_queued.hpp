@@ -0,0 +1,124 @@
+// Part of ssig -- Copyright (c) Christian Neumller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+#ifndef SSIG_QUEUED_HPP_INCLUDED
+#define SSIG_QUEUED_HPP_INCLUDED SSIG_QUEUED_HPP_INCLUDED
+
+#include "ssig.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace ssig {
+
+// A signal whose emissions are not delivered immediately but queued until
+// drain() is called, e.g. at a fixed point of each frame. Besides the usual
+// slots, which are called once per event, batch slots connected with
+// connectBatch() receive all events of a drain() at once, as a Span.
+template<typename R, typename... Args,
+         typename Function, typename Allocator, typename Threading>
+class QueuedSignal<R(Args...), Function, Allocator, Threading> {
+public:
+    typedef Signal<R(Args...), Function, Allocator, Threading> signal_type;
+    typedef typename signal_type::function_type function_type;
+    typedef typename signal_type::connection_type connection_type;
+    typedef typename detail::EventType<Args...>::type event_type;
+    typedef Span<event_type const> span_type;
+    typedef boost::function<void(span_type)> batch_function_type;
+    typedef Signal<void(span_type), batch_function_type, Allocator, Threading> batch_signal_type;
+    typedef typename batch_signal_type::connection_type batch_connection_type;
+
+    explicit QueuedSignal(std::size_t capacity = 0, Allocator const& alloc = Allocator()):
+        m_signal(alloc),
+        m_batchSignal(alloc),
+        m_queue(alloc),
+        m_draining(alloc)
+    {
+        reserve(capacity);
+    }
+
+    // Moves the arguments into the queue. Does not allocate unless more
+    // events are queued than ever before between two drains.
+    template <typename... AF>
+    void operator() (AF&&... args)
+    {
+        m_queue.emplace_back(std::forward<AF>(args)...);
+    }
+
+    // Delivers all events queued so far. Each slot is called for all events,
+    // in the order in which they were queued, before the next slot is called;
+    // slots are taken in the same order as by Signal. Then each batch slot
+    // is called once with all events, unless there are none. Events queued
+    // by the slots are delivered by the next drain(). Returns the number of
+    // events.
+    std::size_t drain()
+    {
+        auto& table = *m_signal.m_slots;
+        typename signal_type::table_type::Emission emission(table);
+        m_draining.swap(m_queue);
+        DrainingReset reset(m_draining);
+        detail::BatchInvoker<Args...>::invoke(table, m_draining.begin(), m_draining.end());
+        if (!m_draining.empty() && !m_batchSignal.empty())
+            m_batchSignal(span_type(m_draining.data(), m_draining.size()));
+        return m_draining.size();
+    }
+
+    connection_type connect(function_type const& slot)
+    {
+        return m_signal.connect(slot);
+    }
+
+    // Connects a slot which is called once per drain() with all events, in
+    // the order in which they were queued, e.g. to process them in a tight
+    // loop or to hand them on in bulk. For signals with a single parameter,
+    // the events are the plain arguments, otherwise tuples of them.
+    batch_connection_type connectBatch(batch_function_type const& slot)
+    {
+        return m_batchSignal.connect(slot);
+    }
+
+    // Discards all queued events.
+    void clear() { m_queue.clear(); }
+
+    // Preallocates room for capacity events.
+    void reserve(std::size_t capacity)
+    {
+        m_queue.reserve(capacity);
+        m_draining.reserve(capacity);
+    }
+
+    std::size_t pending() const { return m_queue.size(); }
+    std::size_t capacity() const { return m_queue.capacity(); }
+    bool empty() const { return m_signal.empty() && m_batchSignal.empty(); }
+
+private:
+    typedef std::vector<event_type, typename std::allocator_traits<Allocator>::template
+        rebind_alloc<event_type>> queue_type;
+
+    // Empties the queue being drained, keeping its capacity, also if a slot
+    // throws.
+    struct DrainingReset {
+        DrainingReset(queue_type& queue): queue(queue) { }
+        ~DrainingReset() { queue.clear(); }
+        queue_type& queue;
+
+        DrainingReset& operator=(DrainingReset const&); // silence warning
+    };
+
+    signal_type m_signal;
+    batch_signal_type m_batchSignal;
+    queue_type m_queue;
+    queue_type m_draining; // swapped with m_queue by drain()
+
+    QueuedSignal(QueuedSignal const&);
+    QueuedSignal& operator=(QueuedSignal const&);
+};
+
+} // namespace ssig
+#endif
@@ -0,0 +1,278 @@
+// Part of ssig -- Copyright (c) Christian Neumller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+// Emission statistics, included by ssig.hpp. Unless SSIG_ENABLE_STATS is
+// defined (consistently in all translation units), the hooks called by the
+// signals are empty inline functions of an empty base class of the slot
+// table, so that they do not cost anything.
+
+#ifndef SSIG_STATS_HPP_INCLUDED
+#define SSIG_STATS_HPP_INCLUDED SSIG_STATS_HPP_INCLUDED
+
+#if defined(SSIG_ENABLE_SLOT_TIMING) && !defined(SSIG_ENABLE_STATS)
+#   define SSIG_ENABLE_STATS
+#endif
+
+#ifdef SSIG_ENABLE_STATS
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#ifdef SSIG_ENABLE_SLOT_TIMING
+#   if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#       include <intrin.h>
+#       define SSIG_HAS_RDTSC
+#   elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#       include <x86intrin.h>
+#       define SSIG_HAS_RDTSC
+#   endif
+#endif
+
+
+namespace ssig {
+
+// A copy of the statistics of one signal.
+struct SignalStatsSnapshot {
+    // Bucket i counts slot calls taking [2^i, 2^(i+1)) ticks of
+    // slotClockTicks(); the last bucket also counts all longer calls.
+    static std::size_t const numLatencyBuckets = 32;
+
+    void const* signal; // the address of the signal's slot table
+    char const* name; // null unless set with Signal::setName()
+    std::uint64_t emissions;
+    std::uint64_t slotCalls;
+    std::uint64_t connects;
+    std::uint64_t disconnects;
+    std::uint64_t sweeps; // compactions of the slot array
+    std::uint64_t sweptSlots; // disconnected slots removed by sweeps
+    std::uint64_t latencyHistogram[numLatencyBuckets]; // all 0 without SSIG_ENABLE_SLOT_TIMING
+
+    std::uint64_t liveSlots() const { return connects - disconnects; }
+};
+
+// The clock used for slot latencies: the time stamp counter on x86, which
+// takes a few cycles to read, and std::chrono::steady_clock (nanoseconds on
+// most platforms) elsewhere.
+inline std::uint64_t slotClockTicks()
+{
+#ifdef SSIG_HAS_RDTSC
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(
+        std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+namespace detail { class SignalStats; }
+
+// All signals which currently exist (with SSIG_ENABLE_STATS only).
+class StatsRegistry {
+public:
+    static StatsRegistry& instance()
+    {
+        static StatsRegistry registry;
+        return registry;
+    }
+
+    std::vector<SignalStatsSnapshot> snapshot() const;
+
+    // Writes one line per signal.
+    void dump(std::ostream& out) const;
+
+private:
+    friend class detail::SignalStats;
+
+    StatsRegistry(): m_first(nullptr) { }
+
+    mutable std::mutex m_mutex;
+    detail::SignalStats* m_first;
+};
+
+namespace detail {
+
+// The statistics of a signal, a base class of its slot table. The counters
+// are only written by the thread invoking the signal, with relaxed loads
+// and stores, so that other threads can read them while the signal is used.
+class SignalStats {
+public:
+    SignalStats(): m_name(nullptr), m_prev(nullptr), m_registered(true)
+    {
+        for (auto& c: m_counters)
+            c.store(0, std::memory_order_relaxed);
+        for (auto& c: m_latency)
+            c.store(0, std::memory_order_relaxed);
+        StatsRegistry& registry = StatsRegistry::instance();
+        std::lock_guard<std::mutex> lock(registry.m_mutex);
+        m_next = registry.m_first;
+        if (m_next)
+            m_next->m_prev = this;
+        registry.m_first = this;
+    }
+
+    ~SignalStats() { unregister(); }
+
+    void setName(char const* name) { m_name.store(name, std::memory_order_relaxed); }
+
+    void emitted() { bump(emissions); }
+    void connected() { bump(connects); }
+    void disconnected() { bump(disconnects); }
+    void swept(std::size_t numSlots) { bump(sweeps); bump(sweptSlots, numSlots); }
+
+    // For slots called concurrently, e.g. by Signal::emitParallel().
+    void slotsCalledConcurrently(std::size_t numSlots)
+    {
+        m_counters[slotCalls].fetch_add(numSlots, std::memory_order_relaxed);
+    }
+
+    // Counts (and, with SSIG_ENABLE_SLOT_TIMING, times) one slot call.
+    class SlotCall {
+    public:
+#ifdef SSIG_ENABLE_SLOT_TIMING
+        explicit SlotCall(SignalStats& stats): m_stats(stats), m_start(slotClockTicks()) { }
+        ~SlotCall() { m_stats.slotCalled(slotClockTicks() - m_start); }
+#else
+        explicit SlotCall(SignalStats& stats): m_stats(stats) { }
+        ~SlotCall() { m_stats.bump(slotCalls); }
+#endif
+    private:
+        SignalStats& m_stats;
+#ifdef SSIG_ENABLE_SLOT_TIMING
+        std::uint64_t m_start;
+#endif
+        SlotCall& operator=(SlotCall const&); // silence warning
+    };
+
+    // Removes the signal from the registry, e.g. when it is destroyed while
+    // its slot table is kept alive by connections.
+    void unregister()
+    {
+        StatsRegistry& registry = StatsRegistry::instance();
+        std::lock_guard<std::mutex> lock(registry.m_mutex);
+        if (!m_registered)
+            return;
+        m_registered = false;
+        if (m_prev)
+            m_prev->m_next = m_next;
+        else
+            registry.m_first = m_next;
+        if (m_next)
+            m_next->m_prev = m_prev;
+    }
+
+    void snapshot(SignalStatsSnapshot& s) const
+    {
+        s.signal = this;
+        s.name = m_name.load(std::memory_order_relaxed);
+        s.emissions = m_counters[emissions].load(std::memory_order_relaxed);
+        s.slotCalls = m_counters[slotCalls].load(std::memory_order_relaxed);
+        s.connects = m_counters[connects].load(std::memory_order_relaxed);
+        s.disconnects = m_counters[disconnects].load(std::memory_order_relaxed);
+        s.sweeps = m_counters[sweeps].load(std::memory_order_relaxed);
+        s.sweptSlots = m_counters[sweptSlots].load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < SignalStatsSnapshot::numLatencyBuckets; ++i)
+            s.latencyHistogram[i] = m_latency[i].load(std::memory_order_relaxed);
+    }
+
+    SignalStats* next() const { return m_next; }
+
+private:
+    enum Counter { emissions, slotCalls, connects, disconnects, sweeps, sweptSlots, numCounters };
+
+    static void bump(std::atomic<std::uint64_t>& c, std::uint64_t n = 1)
+    {
+        // Single writer: no need for an atomic read-modify-write.
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    void bump(Counter c, std::uint64_t n = 1) { bump(m_counters[c], n); }
+
+    void slotCalled(std::uint64_t ticks)
+    {
+        bump(slotCalls);
+        std::size_t bucket = 0;
+        while (ticks > 1 && bucket + 1 < SignalStatsSnapshot::numLatencyBuckets) {
+            ticks >>= 1;
+            ++bucket;
+        }
+        bump(m_latency[bucket]);
+    }
+
+    std::atomic<std::uint64_t> m_counters[numCounters];
+    std::atomic<std::uint64_t> m_latency[SignalStatsSnapshot::numLatencyBuckets];
+    std::atomic<char const*> m_name;
+    SignalStats* m_prev; // in the registry, guarded by its mutex
+    SignalStats* m_next;
+    bool m_registered;
+
+    SignalStats(SignalStats const&);
+    SignalStats& operator=(SignalStats const&);
+};
+
+} // namespace detail
+
+inline std::vector<SignalStatsSnapshot> StatsRegistry::snapshot() const
+{
+    std::vector<SignalStatsSnapshot> result;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (detail::SignalStats* s = m_first; s; s = s->next()) {
+        result.push_back(SignalStatsSnapshot());
+        s->snapshot(result.back());
+    }
+    return result;
+}
+
+inline void StatsRegistry::dump(std::ostream& out) const
+{
+    for (auto const& s: snapshot()) {
+        out << (s.name ? s.name : "<unnamed>") << " (" << s.signal << "):"
+            << " emissions " << s.emissions
+            << ", slot calls " << s.slotCalls
+            << ", live slots " << s.liveSlots()
+            << ", connects " << s.connects
+            << ", disconnects " << s.disconnects
+            << ", sweeps " << s.sweeps
+            << " (" << s.sweptSlots << " slots)";
+#ifdef SSIG_ENABLE_SLOT_TIMING
+        out << ", slot latency histogram (log2 ticks):";
+        for (std::size_t i = 0; i < SignalStatsSnapshot::numLatencyBuckets; ++i) {
+            if (s.latencyHistogram[i])
+                out << ' ' << i << ':' << s.latencyHistogram[i];
+        }
+#endif
+        out << '\n';
+    }
+}
+
+} // namespace ssig
+
+#else // SSIG_ENABLE_STATS
+
+#include <cstddef>
+
+namespace ssig { namespace detail {
+
+class SignalStats {
+public:
+    void setName(char const*) { }
+    void emitted() { }
+    void connected() { }
+    void disconnected() { }
+    void swept(std::size_t) { }
+    void slotsCalledConcurrently(std::size_t) { }
+    void unregister() { }
+
+    struct SlotCall {
+        explicit SlotCall(SignalStats&) { }
+    };
+};
+
+} } // namespace ssig::detail
+
+#endif // SSIG_ENABLE_STATS
+#endif
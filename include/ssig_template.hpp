@@ -2,109 +2,421 @@
 // This file is subject to the terms of the BSD 2-Clause License.
 // See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
 
-#if !BOOST_PP_IS_ITERATING
+#ifndef SSIG_HPP_INCLUDED
 #   error "Do not include this file! Include ssig.hpp instead."
 #endif
 
-#define NARGS BOOST_PP_ITERATION()
+template<typename R, typename... Args, std::size_t BufferSize>
+class Delegate<R(Args...), BufferSize> {
+public:
+    typedef R result_type;
+    static std::size_t const buffer_size = BufferSize;
 
-#define TYPES                BOOST_PP_ENUM_PARAMS(NARGS, A)
-#define TMPL_PARAMS          BOOST_PP_ENUM_PARAMS(NARGS, typename A)
-#define TRAILING_TMPL_PARAMS BOOST_PP_ENUM_TRAILING_PARAMS(NARGS, typename A)
+    Delegate(): m_invoke(nullptr), m_manage(nullptr) { } // construct empty delegate
 
-#define TYPED_ARGS          BOOST_PP_ENUM_BINARY_PARAMS(NARGS, A, arg)
-#define TRAILING_TYPED_ARGS BOOST_PP_COMMA_IF(NARGS) TYPED_ARGS
-#define ARGS                BOOST_PP_ENUM_PARAMS(NARGS, arg)
+    // A null function pointer yields an empty delegate.
+    template <typename F>
+    Delegate(F f, typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, Delegate>::value>::type* = nullptr):
+        m_invoke(nullptr),
+        m_manage(nullptr)
+    {
+        typedef typename std::decay<F>::type functor_type;
+        if (detail::isNullCallable(f))
+            return;
+        static_assert(sizeof(functor_type) <= BufferSize,
+            "callable does not fit into the Delegate's buffer; increase BufferSize");
+        static_assert(std::alignment_of<functor_type>::value
+                <= std::alignment_of<buffer_type>::value,
+            "callable is over-aligned for the Delegate's buffer");
+        new (&m_buffer) functor_type(std::move(f));
+        m_invoke = &invokeFunctor<functor_type>;
+        m_manage = std::is_trivially_copyable<functor_type>::value ?
+            nullptr : &detail::manageDelegate<functor_type>;
+    }
 
-#define PRINT_RREF_ARG(z, n, _) BOOST_PP_CAT(AF, n)&& BOOST_PP_CAT(arg, n)
-#define TYPED_RREF_ARGS         BOOST_PP_ENUM(NARGS, PRINT_RREF_ARG, ~)
-#define PRINT_FWD_ARG(z, n, _)  std::forward<BOOST_PP_CAT(AF, n)>(BOOST_PP_CAT(arg, n))
-#define TRAILING_FWD_ARGS       BOOST_PP_ENUM_TRAILING(NARGS, PRINT_FWD_ARG, ~)
+    // Binds a member function to an object. The member function pointer is
+    // not stored but compiled into the call, e.g.
+    // Delegate<void(int)>::bind<Foo, &Foo::f>(&foo).
+    template <typename T, R (T::*Method)(Args...)>
+    static Delegate bind(T* object)
+    {
+        return Delegate(object, &invokeMethod<T, Method>);
+    }
 
-#if NARGS
-#    define RREF_TMPL template <BOOST_PP_ENUM_PARAMS(NARGS, typename AF)>
-#else
-#    define RREF_TMPL
-#endif
+    template <typename T, R (T::*Method)(Args...) const>
+    static Delegate bind(T const* object)
+    {
+        return Delegate(object, &invokeConstMethod<T, Method>);
+    }
+
+    Delegate(Delegate const& rhs):
+        m_invoke(rhs.m_invoke),
+        m_manage(rhs.m_manage)
+    {
+        if (m_manage)
+            m_manage(detail::delegateCopy, &m_buffer, const_cast<buffer_type*>(&rhs.m_buffer));
+        else
+            m_buffer = rhs.m_buffer;
+    }
+
+    Delegate(Delegate&& rhs):
+        m_invoke(rhs.m_invoke),
+        m_manage(rhs.m_manage)
+    {
+        if (m_manage)
+            m_manage(detail::delegateMove, &m_buffer, &rhs.m_buffer);
+        else
+            m_buffer = rhs.m_buffer;
+        rhs.m_invoke = nullptr;
+        rhs.m_manage = nullptr;
+    }
+
+    Delegate& operator=(Delegate const& rhs)
+    {
+        if (this != &rhs) {
+            Delegate copy(rhs);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    Delegate& operator=(Delegate&& rhs)
+    {
+        if (this != &rhs) {
+            clear();
+            m_invoke = rhs.m_invoke;
+            m_manage = rhs.m_manage;
+            if (m_manage)
+                m_manage(detail::delegateMove, &m_buffer, &rhs.m_buffer);
+            else
+                m_buffer = rhs.m_buffer;
+            rhs.m_invoke = nullptr;
+            rhs.m_manage = nullptr;
+        }
+        return *this;
+    }
+
+    ~Delegate() { clear(); }
+
+    bool empty() const { return !m_invoke; }
+
+    void clear()
+    {
+        if (m_manage)
+            m_manage(detail::delegateDestroy, &m_buffer, nullptr);
+        m_invoke = nullptr;
+        m_manage = nullptr;
+    }
+
+    R operator() (typename detail::ParamType<Args>::type... args) const
+    {
+        if (!m_invoke)
+            throw SsigError("attempt to call an empty delegate");
+        return m_invoke(const_cast<buffer_type*>(&m_buffer), detail::slotArg<Args>(args)...);
+    }
+
+private:
+    typedef typename std::aligned_storage<BufferSize>::type buffer_type;
+    typedef R (*invoker_type)(void*, typename detail::ParamType<Args>::type...);
+
+    template <typename T>
+    Delegate(T* object, invoker_type invoke):
+        m_invoke(invoke),
+        m_manage(nullptr)
+    {
+        static_assert(sizeof(T*) <= BufferSize, "BufferSize too small");
+        new (&m_buffer) T*(object);
+    }
+
+    template <typename F>
+    static R invokeFunctor(void* buffer, typename detail::ParamType<Args>::type... args)
+    {
+        return static_cast<R>((*static_cast<F*>(buffer))(detail::slotArg<Args>(args)...));
+    }
+
+    template <typename T, R (T::*Method)(Args...)>
+    static R invokeMethod(void* buffer, typename detail::ParamType<Args>::type... args)
+    {
+        return ((*static_cast<T**>(buffer))->*Method)(detail::slotArg<Args>(args)...);
+    }
+
+    template <typename T, R (T::*Method)(Args...) const>
+    static R invokeConstMethod(void* buffer, typename detail::ParamType<Args>::type... args)
+    {
+        return ((*static_cast<T const**>(buffer))->*Method)(detail::slotArg<Args>(args)...);
+    }
+
+    buffer_type m_buffer;
+    invoker_type m_invoke;
+    void (*m_manage)(detail::DelegateOperation, void*, void*);
+};
 
-template<typename R TRAILING_TMPL_PARAMS>
-class Signal<R(TYPES)> {
+template<typename R, typename... Args,
+         typename Function, typename Allocator, typename Threading>
+class Signal<R(Args...), Function, Allocator, Threading> {
 public:
-    typedef boost::function<R(TYPES)> function_type;
-    typedef Connection<R(TYPES)> connection_type;
+    typedef Function function_type;
+    typedef Allocator allocator_type;
+    typedef Threading threading_policy;
+    typedef Connection<R(Args...), Function, Allocator, Threading> connection_type;
 
-    Signal():
-        m_calling(false)
+    explicit Signal(Allocator const& alloc = Allocator()):
+        m_slots(table_type::create(alloc))
     {
     }
 
-    RREF_TMPL
-    R const operator() (TYPED_RREF_ARGS);
+    // Constructs a signal named as by setName().
+    explicit Signal(char const* name, Allocator const& alloc = Allocator()):
+        m_slots(table_type::create(alloc))
+    {
+        m_slots->setName(name);
+    }
+
+    // Takes over the slots (and connections) of rhs, which is left empty.
+    Signal(Signal&& rhs):
+        m_slots(table_type::create(rhs.m_slots->allocator()))
+    {
+        m_slots.swap(rhs.m_slots);
+    }
+
+    // Disconnects all slots, then takes over those of rhs, which is left
+    // empty.
+    Signal& operator=(Signal&& rhs)
+    {
+        if (this != &rhs) {
+            boost::intrusive_ptr<table_type> table(table_type::create(rhs.m_slots->allocator()));
+            m_slots->clear();
+            m_slots.swap(rhs.m_slots);
+            rhs.m_slots.swap(table);
+        }
+        return *this;
+    }
+
+    ~Signal() { m_slots->clear(); }
+
+    template <typename... AF>
+    R const operator() (AF&&... args);
+
+
+    // Calls the slots concurrently on pool (see ssig_parallel.hpp) and
+    // returns when all of them have returned. The results are discarded.
+    template <typename Pool>
+    void emitParallel(Pool& pool, typename detail::ParamType<Args>::type... args)
+    {
+        typename table_type::Emission emission(*m_slots);
+        detail::ParallelInvoker<Pool>::invoke(pool, *m_slots,
+            [&](function_type& f) { f(detail::slotArg<Args>(args)...); });
+    }
+
+    // As above, but combines the results of the slots with Reduce, which
+    // must be associative, e.g. emitParallel<std::plus<int>>(pool, 42).
+    template <typename Reduce, typename Pool>
+    R emitParallel(Pool& pool, typename detail::ParamType<Args>::type... args)
+    {
+        typename table_type::Emission emission(*m_slots);
+        return detail::ParallelInvoker<Pool>::template reduce<R, Reduce>(pool, *m_slots,
+            [&](function_type& f) -> R { return f(detail::slotArg<Args>(args)...); });
+    }
+
+    // Calls the slots as operator() does, passing each result to a
+    // default-constructed Combiner (e.g. Sum or AnyOf), and returns its
+    // result(). Stops calling slots when the combiner returns false.
+    template <typename Combiner>
+    typename Combiner::result_type emit(typename detail::ParamType<Args>::type... args)
+    {
+        Combiner combiner;
+        combine(combiner, detail::slotArg<Args>(args)...);
+        return combiner.result();
+    }
+
+    // As emit<Combiner>(), but with a combiner provided by the caller, e.g.
+    // a CollectInto.
+    template <typename Combiner>
+    void combine(Combiner& combiner, typename detail::ParamType<Args>::type... args)
+    {
+        typename table_type::Emission emission(*m_slots);
+        detail::SignalInvoker<R(Args...)>::combine(
+            *this, combiner, detail::slotArg<Args>(args)...);
+    }
+
+    // Calls the slots for each event in [first, last), a range of tuples
+    // of arguments or, for signals with a single parameter, of plain
+    // arguments. Each slot is called for all events, in order, before the
+    // next slot is called; slots are taken in the order of operator().
+    // Results are discarded.
+    template <typename ForwardIterator>
+    void emitBatch(ForwardIterator first, ForwardIterator last)
+    {
+        typename table_type::Emission emission(*m_slots);
+        detail::BatchInvoker<Args...>::invoke(*m_slots, first, last);
+    }
 
+    // As above, for a container of tuples such as a std::vector.
+    template <typename Range>
+    void emitBatch(Range&& events)
+    {
+        emitBatch(std::begin(events), std::end(events));
+    }
 
     connection_type connect(function_type const& slot);
 
-    bool empty() const {
-        for (auto const& slot: m_slots) {
-            if (!slot->empty())
-                return false;
-        }
+    // Connects a slot which is called before all slots with a higher
+    // priority and after all slots with a lower one. Slots connected without
+    // a priority have priority 0. An enum can name the priorities, e.g.
+    // enum Phase { physics, gameplay, ui }.
+    connection_type connect(int priority, function_type const& slot)
+    {
+        return connection_type(*this, priority, slot);
+    }
+
+    // Connects a slot and adds the connection to group.
+    connection_type connect(ConnectionGroup& group, function_type const& slot)
+    {
+        connection_type connection(connect(slot));
+        group.add(connection);
+        return connection;
+    }
+
+    // Connects a slot which is disconnected when receiver is destroyed.
+    connection_type connect(Trackable& receiver, function_type const& slot)
+    {
+        return connect(receiver.trackedConnections(), slot);
+    }
+
+    // Connects a slot which is not run by the emitting thread but handed
+    // over to executor, e.g. a Mailbox (see ssig_mailbox.hpp).
+    template <typename Executor>
+    typename std::enable_if<!std::is_base_of<Trackable, Executor>::value &&
+        !std::is_arithmetic<Executor>::value && !std::is_enum<Executor>::value,
+        connection_type>::type
+    connect(Executor& executor, function_type const& slot)
+    {
+        return connect(function_type(
+            detail::ExecutorSlot<R(Args...), function_type, Executor>(executor, slot)));
+    }
+
+    bool empty() const { return m_slots->numLive() == 0; }
+
+    // Number of connected slots.
+    std::size_t size() const { return m_slots->numLive(); }
+
+    // Invokes the signal with the arguments returned by makeArgs(), as a
+    // std::tuple, but only calls makeArgs() if any slot is connected.
+    // Results are discarded. Returns true if the signal was invoked.
+    template <typename ArgFactory>
+    bool emitLazy(ArgFactory&& makeArgs)
+    {
+        if (empty())
+            return false;
+        auto args = makeArgs();
+        emitTuple(args, typename detail::MakeIndexSequence<sizeof...(Args)>::type());
         return true;
     }
 
+    // Disconnected slots are left in place as tombstones and removed in one
+    // pass once their share of all slots exceeds the compaction threshold.
+    std::size_t tombstones() const { return m_slots->numDead(); }
+
+    void compact()
+    {
+        if (m_slots->deferring())
+            throw SsigError("attempt to compact a signal while it is invoked");
+        if (m_slots->numDead())
+            m_slots->compact();
+    }
+
+    void setCompactionThreshold(float deadRatio)
+    {
+        m_slots->setCompactionThreshold(deadRatio);
+    }
+
+    // Names the signal in statistics and traces (see ssig_stats.hpp and
+    // ssig_trace.hpp). name must outlive the signal. Does nothing unless
+    // SSIG_ENABLE_STATS or SSIG_ENABLE_TRACING is defined.
+    void setName(char const* name) { m_slots->setName(name); }
+
 
 private:
-    friend Connection<R(TYPES)>;
-    friend detail::SignalInvoker<R(TYPES)>;
+    template <typename Tuple, std::size_t... Is>
+    void emitTuple(Tuple& args, detail::IndexSequence<Is...>)
+    {
+        (*this)(detail::BatchArg<Args>::get(std::get<Is>(args))...);
+    }
 
-    typedef std::forward_list<boost::shared_ptr<function_type>> container_type;
-    container_type m_slots;
-    bool m_calling;
+    friend connection_type;
+    friend detail::SignalInvoker<R(Args...)>;
+    friend class CompactSignal<R(Args...), Function, Allocator, Threading>;
+    friend class QueuedSignal<R(Args...), Function, Allocator, Threading>;
+
+    typedef detail::SlotTable<function_type, Allocator, Threading> table_type;
+    boost::intrusive_ptr<table_type> m_slots;
+
+    // Not copyable: Connections refer to the slot table of one signal, so
+    // a copy could neither share the table nor copy its connections.
+    Signal(Signal const&);
+    Signal& operator=(Signal const&);
 };
 
 namespace detail {
 
-    template<typename R TRAILING_TMPL_PARAMS>
-    struct SignalInvoker<R(TYPES)> {
-        static R const invoke(Signal<R(TYPES)>& signal TRAILING_TYPED_ARGS)
+    template<typename R, typename... Args>
+    struct SignalInvoker<R(Args...)> {
+        template <typename SignalT>
+        static R const invoke(SignalT& signal, typename detail::ParamType<Args>::type... args)
         {
-            if (signal.m_slots.empty())
-                throw SsigError("attempt to invoke empty signal with non-void return type");
-            for (auto it = signal.m_slots.begin(); ; ) {
-                R r((**it)(ARGS));
-                for (;;) {
-                    auto next = boost::next(it);
-                    if (next == signal.m_slots.end()) {
+            typedef typename SignalT::table_type table_type;
+            auto& table = *signal.m_slots;
+            typename table_type::Deferral deferral(table);
+            auto& slots = table.slots();
+            // Slots are called in reverse order of connection.
+            std::size_t i = slots.size();
+            do {
+                if (i == 0)
+                    throw SsigError("attempt to invoke empty signal with non-void return type");
+            } while (slots[--i].id == table_type::invalidId);
+            for (;;) {
+                typename table_type::SlotCall probe(table, slots[i].id);
+                R r(slots[i].function(detail::slotArg<Args>(args)...));
+                do {
+                    if (i == 0)
                         return r; // return last result
-                    } if ((*next)->empty()) {
-                        signal.m_slots.erase_after(it);
-                    } else {
-                        it = std::move(next);
-                        break;
-                    }
-                }
+                } while (slots[--i].id == table_type::invalidId);
+            }
+        }
+
+        template <typename SignalT, typename Combiner>
+        static void combine(SignalT& signal, Combiner& combiner,
+                            typename detail::ParamType<Args>::type... args)
+        {
+            typedef typename SignalT::table_type table_type;
+            auto& table = *signal.m_slots;
+            typename table_type::Deferral deferral(table);
+            auto& slots = table.slots();
+            for (std::size_t i = slots.size(); i-- > 0; ) {
+                if (slots[i].id == table_type::invalidId)
+                    continue;
+                typename table_type::SlotCall probe(table, slots[i].id);
+                if (!combiner(slots[i].function(detail::slotArg<Args>(args)...)))
+                    return;
             }
         }
     };
 
-    template<TMPL_PARAMS>
-    struct SignalInvoker<void(TYPES)> {
-        static void invoke(Signal<void(TYPES)>& signal TRAILING_TYPED_ARGS)
+    template<typename... Args>
+    struct SignalInvoker<void(Args...)> {
+        template <typename SignalT>
+        static void invoke(SignalT& signal, typename detail::ParamType<Args>::type... args)
         {
-            if (signal.m_slots.empty())
-                return;
-            for (auto it = signal.m_slots.begin(); ; ) {
-                (**it)(ARGS);
-                for (;;) {
-                    auto next = boost::next(it);
-                    if (next == signal.m_slots.end()) {
-                        return;
-                    } if ((*next)->empty()) {
-                        signal.m_slots.erase_after(it);
-                    } else {
-                        it = std::move(next);
-                        break;
-                    }
+            typedef typename SignalT::table_type table_type;
+            auto& table = *signal.m_slots;
+            typename table_type::Deferral deferral(table);
+            auto& slots = table.slots();
+            // Slots are called in reverse order of connection.
+            for (std::size_t i = slots.size(); i-- > 0; ) {
+                if (slots[i].id != table_type::invalidId) {
+                    typename table_type::SlotCall probe(table, slots[i].id);
+                    slots[i].function(detail::slotArg<Args>(args)...);
                 }
             }
         }
@@ -112,90 +424,132 @@ namespace detail {
 
 } // namespace detail
 
-template<typename R TRAILING_TMPL_PARAMS>
-RREF_TMPL
-R const Signal<R(TYPES)>::operator() (TYPED_RREF_ARGS)
+template<typename R, typename... Args,
+         typename Function, typename Allocator, typename Threading>
+template <typename... AF>
+R const Signal<R(Args...), Function, Allocator, Threading>::operator() (AF&&... args)
 {
-    detail::Calling lock(m_calling);
-    while (!m_slots.empty() && m_slots.front()->empty())
-        m_slots.pop_front();
-    return detail::SignalInvoker<R(TYPES)>::invoke(*this TRAILING_FWD_ARGS);
+    typename table_type::Emission emission(*m_slots);
+    return detail::SignalInvoker<R(Args...)>::invoke(*this, std::forward<AF>(args)...);
 }
 
-template<typename R TRAILING_TMPL_PARAMS>
-class Connection<R(TYPES)>: public ConnectionBase {
+template<typename R, typename... Args,
+         typename Function, typename Allocator, typename Threading>
+class Connection<R(Args...), Function, Allocator, Threading>: public ConnectionBase {
 public:
-    typedef Signal<R(TYPES)> signal_type;
+    typedef Signal<R(Args...), Function, Allocator, Threading> signal_type;
     static_assert(
         std::is_same<typename signal_type::connection_type, Connection>::value,
         "internal error: inconsistent typedef");
 
-    Connection() { } // construct disconnected signal
+    Connection(): m_id(0), m_generation(0) { } // construct disconnected signal
     
     // For MSVC, define move & copy declarations explicitly.
     Connection(Connection&& rhs):
-        m_slot(std::move(rhs.m_slot))
+        m_table(std::move(rhs.m_table)),
+        m_id(rhs.m_id),
+        m_generation(rhs.m_generation)
     {
     }
 
     Connection& operator=(Connection&& rhs)
     {
-       m_slot = std::move(rhs.m_slot);
+       m_table = std::move(rhs.m_table);
+       m_id = rhs.m_id;
+       m_generation = rhs.m_generation;
        return *this;
     }
     
     Connection(Connection const& rhs):
-        m_slot(rhs.m_slot)
+        m_table(rhs.m_table),
+        m_id(rhs.m_id),
+        m_generation(rhs.m_generation)
     {
     }
 
     Connection& operator=(Connection const& rhs)
     {
-       m_slot = rhs.m_slot;
+       m_table = rhs.m_table;
+       m_id = rhs.m_id;
+       m_generation = rhs.m_generation;
        return *this;
     }
 
-    Connection(signal_type& signal, typename signal_type::function_type const& slot)
+    Connection(signal_type& signal, typename signal_type::function_type const& slot):
+        m_id(0),
+        m_generation(0)
+    {
+        connect(signal.m_slots, slot);
+    }
+
+    Connection(signal_type& signal, int priority,
+               typename signal_type::function_type const& slot):
+        m_id(0),
+        m_generation(0)
     {
-        auto slotPointer = boost::make_shared<
-            typename signal_type::function_type>(slot);
-        m_slot = slotPointer;
-        signal.m_slots.push_front(std::move(slotPointer));
+        connect(signal.m_slots, slot, priority);
     }
 
     bool isConnected() const
     {
-        if (m_slot.expired())
+        if (!m_table)
             return false;
-        if (m_slot.lock()->empty()) {
-            const_cast<Connection<R(TYPES)>*>(this)->m_slot.reset();
+        if (!m_table->isConnected(m_id, m_generation)) {
+            const_cast<Connection*>(this)->m_table.reset();
             return false;
         }
         return true;
     }
-    void disconnect() { checkConnection(); m_slot.lock()->clear(); }
-    R invokeSlot(TYPED_ARGS) { checkConnection(); return (*m_slot.lock())(ARGS); }
+    void disconnect() { checkConnection(); m_table->disconnect(m_id); }
+    R invokeSlot(typename detail::ParamType<Args>::type... args)
+    {
+        checkConnection();
+        typename table_type::Deferral deferral(*m_table);
+        typename table_type::SlotCall probe(*m_table, m_id);
+        return m_table->slot(m_id).function(detail::slotArg<Args>(args)...);
+    }
 
 private:
+    typedef typename signal_type::table_type table_type;
+    friend class CompactSignal<R(Args...), Function, Allocator, Threading>;
+    friend class ConnectionGroup;
+    template <class, class, class, class, class, class, class>
+    friend class KeyedSignal;
+
+    void connect(boost::intrusive_ptr<table_type> const& table,
+                 typename signal_type::function_type const& slot, int priority = 0)
+    {
+        if (detail::isEmptySlot(slot))
+            return;
+        m_id = table->connect(slot, m_generation, priority);
+        m_table = table;
+    }
+
     void checkConnection() const
     {
         if (!isConnected())
             throw SsigError("attempt to use a disconnected signal");
     }
 
-    boost::weak_ptr<typename signal_type::function_type> m_slot;
+    boost::intrusive_ptr<table_type> m_table;
+    typename table_type::id_type m_id;
+    unsigned m_generation;
 };
 
-template<typename R TRAILING_TMPL_PARAMS>
-typename Signal<R(TYPES)>::connection_type Signal<R(TYPES)>::connect(function_type const& slot)
+template<typename R, typename... Args,
+         typename Function, typename Allocator, typename Threading>
+typename Signal<R(Args...), Function, Allocator, Threading>::connection_type
+Signal<R(Args...), Function, Allocator, Threading>::connect(function_type const& slot)
 {
     return connection_type(*this, slot);
 }
 
-template<typename R TRAILING_TMPL_PARAMS>
-class ScopedConnection<R(TYPES)>: public Connection<R(TYPES)>
+template<typename R, typename... Args,
+         typename Function, typename Allocator, typename Threading>
+class ScopedConnection<R(Args...), Function, Allocator, Threading>:
+    public Connection<R(Args...), Function, Allocator, Threading>
 {
-    typedef Connection<R(TYPES)> base_t;
+    typedef Connection<R(Args...), Function, Allocator, Threading> base_t;
     typedef typename base_t::signal_type signal_type;
 public:
     ScopedConnection() { }
@@ -234,3 +588,188 @@ public:
             this->disconnect();
     }
 };
+
+// A signal which is only one pointer wide and does not allocate anything
+// before the first slot is connected, for objects with many signals which
+// mostly have no slots. Slots are called as by Signal.
+template<typename R, typename... Args,
+         typename Function, typename Allocator, typename Threading>
+class CompactSignal<R(Args...), Function, Allocator, Threading>:
+    private detail::AllocatorHolder<Allocator>, private detail::DeferredName {
+public:
+    typedef Signal<R(Args...), Function, Allocator, Threading> signal_type;
+    typedef Function function_type;
+    typedef Allocator allocator_type;
+    typedef Threading threading_policy;
+    typedef typename signal_type::connection_type connection_type;
+
+    // alloc is kept for the slot table created by the first connect(); a
+    // stateless allocator takes no space.
+    explicit CompactSignal(Allocator const& alloc = Allocator()): holder_type(alloc) { }
+
+    // Constructs a signal named as by setName().
+    explicit CompactSignal(char const* name, Allocator const& alloc = Allocator()):
+        holder_type(alloc),
+        DeferredName(name)
+    {
+    }
+
+    // Takes over the slots (and connections) of rhs, which is left empty.
+    CompactSignal(CompactSignal&& rhs):
+        holder_type(rhs.allocator()),
+        DeferredName(rhs.name()),
+        m_slots(std::move(rhs.m_slots))
+    {
+    }
+
+    // Disconnects all slots, then takes over those of rhs.
+    CompactSignal& operator=(CompactSignal&& rhs)
+    {
+        if (this != &rhs) {
+            if (m_slots)
+                m_slots->clear();
+            m_slots = std::move(rhs.m_slots);
+        }
+        return *this;
+    }
+
+    ~CompactSignal()
+    {
+        if (m_slots)
+            m_slots->clear();
+    }
+
+    template <typename... AF>
+    R const operator() (AF&&... args)
+    {
+        if (!m_slots)
+            return detail::StaticInvoker<R(Args...)>::invoke(std::forward<AF>(args)...);
+        typename table_type::Emission emission(*m_slots);
+        return detail::SignalInvoker<R(Args...)>::invoke(*this, std::forward<AF>(args)...);
+    }
+
+    connection_type connect(function_type const& slot)
+    {
+        return connect(0, slot);
+    }
+
+    // As Signal::connect(int, function_type const&).
+    connection_type connect(int priority, function_type const& slot)
+    {
+        if (!m_slots) {
+            m_slots = table_type::create(this->allocator());
+            if (name())
+                m_slots->setName(name());
+        }
+        connection_type connection;
+        connection.connect(m_slots, slot, priority);
+        return connection;
+    }
+
+    connection_type connect(ConnectionGroup& group, function_type const& slot)
+    {
+        connection_type connection(connect(slot));
+        group.add(connection);
+        return connection;
+    }
+
+    connection_type connect(Trackable& receiver, function_type const& slot)
+    {
+        return connect(receiver.trackedConnections(), slot);
+    }
+
+    bool empty() const { return !m_slots || m_slots->numLive() == 0; }
+    std::size_t size() const { return m_slots ? m_slots->numLive() : 0; }
+
+    // As Signal::setName(); a name set before the first connect() is applied
+    // when the slot table is created.
+    void setName(char const* name)
+    {
+        DeferredName::setName(name);
+        if (m_slots)
+            m_slots->setName(name);
+    }
+
+private:
+    friend detail::SignalInvoker<R(Args...)>;
+
+    typedef typename signal_type::table_type table_type;
+    typedef detail::AllocatorHolder<Allocator> holder_type;
+    boost::intrusive_ptr<table_type> m_slots; // null until the first connect()
+
+    CompactSignal(CompactSignal const&);
+    CompactSignal& operator=(CompactSignal const&);
+};
+
+namespace detail {
+
+    template<typename R, typename... Args>
+    struct StaticInvoker<R(Args...)> {
+        static R invoke(typename detail::ParamType<Args>::type...)
+        {
+            throw SsigError("attempt to invoke empty signal with non-void return type");
+        }
+    };
+
+    template<typename... Args>
+    struct StaticInvoker<void(Args...)> {
+        static void invoke(typename detail::ParamType<Args>::type...) { }
+    };
+
+    template<typename R, typename... Args, R (*Slot)(Args...)>
+    struct StaticInvoker<R(Args...), Slot> {
+        static R invoke(typename detail::ParamType<Args>::type... args)
+        {
+            return Slot(detail::slotArg<Args>(args)...);
+        }
+    };
+
+    template<typename R, typename... Args,
+             R (*Slot)(Args...), R (*Next)(Args...), R (*... Slots)(Args...)>
+    struct StaticInvoker<R(Args...), Slot, Next, Slots...> {
+        static R invoke(typename detail::ParamType<Args>::type... args)
+        {
+            Slot(detail::slotArg<Args>(args)...);
+            return StaticInvoker<R(Args...), Next, Slots...>::invoke(slotArg<Args>(args)...);
+        }
+    };
+
+} // namespace detail
+
+template<typename R, typename... Args, R (*... Slots)(Args...)>
+class StaticSignal<R(Args...), Slots...> {
+public:
+    typedef Signal<R(Args...)> dynamic_signal_type;
+    typedef typename dynamic_signal_type::function_type function_type;
+    typedef typename dynamic_signal_type::connection_type connection_type;
+
+    StaticSignal() { }
+
+    // The name applies to the dynamically connected slots only, see
+    // Signal::setName().
+    explicit StaticSignal(char const* name): m_dynamic(name) { }
+
+    // Calls the fixed slots in the order in which they are listed, followed
+    // by the dynamically connected ones. Returns the result of the slot called
+    // last.
+    R const operator() (typename detail::ParamType<Args>::type... args)
+    {
+        if (m_dynamic.empty())
+            return detail::StaticInvoker<R(Args...), Slots...>::invoke(
+                detail::slotArg<Args>(args)...);
+        typedef int expand[];
+        (void)expand{0, (static_cast<void>(Slots(detail::slotArg<Args>(args)...)), 0)...};
+        return m_dynamic(detail::slotArg<Args>(args)...);
+    }
+
+    // Connects a slot at runtime, to be called after the fixed slots.
+    connection_type connect(function_type const& slot)
+    {
+        return m_dynamic.connect(slot);
+    }
+
+    bool empty() const { return sizeof...(Slots) == 0 && m_dynamic.empty(); }
+
+private:
+    dynamic_signal_type m_dynamic;
+};
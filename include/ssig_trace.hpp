@@ -0,0 +1,268 @@
+// Part of ssig -- Copyright (c) Christian Neumller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+// Tracing of emissions and slot calls, included by ssig.hpp. Unless
+// SSIG_ENABLE_TRACING is defined (consistently in all translation units),
+// the hooks called by the signals are empty inline functions of an empty
+// base class of the slot table, so that they do not cost anything.
+
+#ifndef SSIG_TRACE_HPP_INCLUDED
+#define SSIG_TRACE_HPP_INCLUDED SSIG_TRACE_HPP_INCLUDED
+
+#ifdef SSIG_ENABLE_TRACING
+
+#ifndef SSIG_TRACE_BUFFER_SIZE
+#   define SSIG_TRACE_BUFFER_SIZE 65536
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+
+namespace ssig {
+
+// A begin ('B') or end ('E') event of an emission or of a slot call.
+struct TraceEvent {
+    static std::size_t const noSlot = static_cast<std::size_t>(-1);
+
+    std::uint64_t timestamp; // nanoseconds since the TraceRecorder was created
+    char const* name; // of the signal, may be null
+    void const* signal;
+    std::size_t slot; // the id of the slot, or noSlot for emissions
+    char phase;
+};
+
+// Collects trace events in a buffer per thread and writes them in the
+// Chrome trace event format, which chrome://tracing and Perfetto display.
+// Recording an event does not lock anything: each thread appends to its own
+// buffer of SSIG_TRACE_BUFFER_SIZE events and drops events once the buffer
+// is full.
+class TraceRecorder {
+public:
+    static TraceRecorder& instance()
+    {
+        static TraceRecorder recorder;
+        return recorder;
+    }
+
+    void start() { m_recording.store(true, std::memory_order_relaxed); }
+    void stop() { m_recording.store(false, std::memory_order_relaxed); }
+    bool recording() const { return m_recording.load(std::memory_order_relaxed); }
+
+    // Discards all events. Must not be called while any thread is recording.
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& buffer: m_buffers) {
+            buffer->size.store(0, std::memory_order_relaxed);
+            buffer->dropped.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    // Number of events dropped because a buffer was full.
+    std::size_t droppedEvents() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::size_t n = 0;
+        for (auto const& buffer: m_buffers)
+            n += buffer->dropped.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // Writes the recorded events as a JSON trace. May be called while
+    // other threads are recording; their later events are not included.
+    void writeChromeTrace(std::ostream& out) const;
+
+    void record(char phase, char const* name, void const* signal, std::size_t slot)
+    {
+        Buffer& buffer = threadBuffer();
+        std::size_t const n = buffer.size.load(std::memory_order_relaxed);
+        if (n == buffer.events.size()) {
+            buffer.dropped.store(
+                buffer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        TraceEvent& e = buffer.events[n];
+        e.timestamp = static_cast<std::uint64_t>(std::chrono::duration_cast<
+            std::chrono::nanoseconds>(clock_type::now() - m_origin).count());
+        e.name = name;
+        e.signal = signal;
+        e.slot = slot;
+        e.phase = phase;
+        buffer.size.store(n + 1, std::memory_order_release); // publish the event
+    }
+
+private:
+    typedef std::chrono::steady_clock clock_type;
+
+    // Only the owning thread appends events; size publishes them to
+    // writeChromeTrace().
+    struct Buffer {
+        explicit Buffer(unsigned threadId):
+            events(SSIG_TRACE_BUFFER_SIZE), size(0), dropped(0), threadId(threadId) { }
+        std::vector<TraceEvent> events;
+        std::atomic<std::size_t> size;
+        std::atomic<std::size_t> dropped;
+        unsigned const threadId;
+    };
+
+    TraceRecorder(): m_recording(false), m_origin(clock_type::now()) { }
+
+    Buffer& threadBuffer()
+    {
+        static thread_local Buffer* buffer = nullptr;
+        if (!buffer) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_buffers.emplace_back(new Buffer(static_cast<unsigned>(m_buffers.size() + 1)));
+            buffer = m_buffers.back().get();
+        }
+        return *buffer;
+    }
+
+    static void writeString(std::ostream& out, char const* s)
+    {
+        static char const hex[] = "0123456789abcdef";
+        out << '"';
+        for (; *s; ++s) {
+            unsigned char const c = static_cast<unsigned char>(*s);
+            if (c == '"' || c == '\\')
+                out << '\\' << *s;
+            else if (c < 0x20)
+                out << "\\u00" << hex[c >> 4] << hex[c & 0xf];
+            else
+                out << *s;
+        }
+        out << '"';
+    }
+
+    std::atomic<bool> m_recording;
+    clock_type::time_point const m_origin;
+    mutable std::mutex m_mutex; // guards m_buffers
+    std::vector<std::unique_ptr<Buffer>> m_buffers; // never shrinks: see threadBuffer()
+};
+
+inline void TraceRecorder::writeChromeTrace(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    for (auto const& buffer: m_buffers) {
+        std::size_t const n = buffer->size.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < n; ++i) {
+            TraceEvent const& e = buffer->events[i];
+            out << (first ? "\n" : ",\n") << "{\"name\": ";
+            first = false;
+            writeString(out, e.name ? e.name : "signal");
+            if (e.slot == TraceEvent::noSlot)
+                out << ", \"cat\": \"ssig.emit\"";
+            else
+                out << ", \"cat\": \"ssig.slot\"";
+            out << ", \"ph\": \"" << e.phase << "\", \"pid\": 1, \"tid\": " << buffer->threadId
+                << ", \"ts\": " << e.timestamp / 1000 << '.'
+                << static_cast<char>('0' + e.timestamp / 100 % 10)
+                << static_cast<char>('0' + e.timestamp / 10 % 10)
+                << static_cast<char>('0' + e.timestamp % 10)
+                << ", \"args\": {\"signal\": \"" << e.signal << '"';
+            if (e.slot != TraceEvent::noSlot)
+                out << ", \"slot\": " << e.slot;
+            out << "}}";
+        }
+    }
+    out << "\n]}\n";
+}
+
+namespace detail {
+
+// The tracing hooks of a signal, a base class of its slot table.
+class SignalTrace {
+public:
+    SignalTrace(): m_name(nullptr) { }
+
+    void setName(char const* name) { m_name = name; }
+
+    // Records the begin and end of an emission if the recorder is running
+    // at its beginning.
+    class Emission {
+    public:
+        explicit Emission(SignalTrace const& trace):
+            m_trace(TraceRecorder::instance().recording() ? &trace : nullptr)
+        {
+            if (m_trace)
+                m_trace->record('B', TraceEvent::noSlot);
+        }
+        ~Emission()
+        {
+            if (m_trace)
+                m_trace->record('E', TraceEvent::noSlot);
+        }
+    private:
+        SignalTrace const* const m_trace;
+
+        Emission& operator=(Emission const&); // silence warning
+    };
+
+    // As Emission, for the call of the slot with the given id.
+    class SlotCall {
+    public:
+        SlotCall(SignalTrace const& trace, std::size_t slot):
+            m_trace(TraceRecorder::instance().recording() ? &trace : nullptr),
+            m_slot(slot)
+        {
+            if (m_trace)
+                m_trace->record('B', m_slot);
+        }
+        ~SlotCall()
+        {
+            if (m_trace)
+                m_trace->record('E', m_slot);
+        }
+    private:
+        SignalTrace const* const m_trace;
+        std::size_t const m_slot;
+
+        SlotCall& operator=(SlotCall const&); // silence warning
+    };
+
+private:
+    void record(char phase, std::size_t slot) const
+    {
+        TraceRecorder::instance().record(phase, m_name, this, slot);
+    }
+
+    char const* m_name;
+};
+
+} // namespace detail
+
+} // namespace ssig
+
+#else // SSIG_ENABLE_TRACING
+
+#include <cstddef>
+
+namespace ssig { namespace detail {
+
+class SignalTrace {
+public:
+    void setName(char const*) { }
+
+    struct Emission {
+        explicit Emission(SignalTrace const&) { }
+    };
+
+    struct SlotCall {
+        SlotCall(SignalTrace const&, std::size_t) { }
+    };
+};
+
+} } // namespace ssig::detail
+
+#endif // SSIG_ENABLE_TRACING
+#endif
@@ -1,144 +1,564 @@
-#include <iostream> // cout, cerr
-#include <boost/timer/timer.hpp>
-#include <functional> // std::function
-#include <boost/function.hpp>
-#define BOOST_SIGNALS_NO_DEPRECATION_WARNING
-#include <boost/signal.hpp>
-#include <boost/signals2/signal.hpp>
-#include <vector>
-#include <cstdlib>  // atol
+// Part of ssig -- Copyright (c) Christian Neumüller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+// Runtime benchmark: measures the time per emission (and per called slot)
+// of ssig and, for comparison, of Boost.Signals2 and a std::vector of
+// std::function in several scenarios. Each scenario is set up anew for each
+// repetition; a repetition takes a number of samples, each of which times a
+// batch of emissions lasting about 100 microseconds. A sample is thus the
+// mean time per emission of its batch, and the printed percentiles are
+// percentiles of these batch means, not of the latencies of single
+// emissions. The distribution of the samples is printed and can be written
+// as JSON, e.g. to compare releases.
+//
+// Usage: ssig_benchmark [--repetitions N] [--samples N] [--filter TEXT]
+//                       [--json FILE]
+
 #include <ssig.hpp>
+#include <ssig_keyed.hpp>
+#include <boost/signals2/signal.hpp>
 
-using std::cout;
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <numeric>
+#include <ostream>
+#include <string>
+#include <tuple>
+#include <vector>
 
 namespace {
 
-struct B {
-    virtual ~B() {}
-    virtual int operator() (int i) const = 0;
+typedef std::chrono::steady_clock clock_type;
+
+// Written by the slots so that the calls cannot be optimized away.
+unsigned long g_sink = 0;
+
+void sink(int i) { g_sink += static_cast<unsigned>(i); }
+
+// Deterministic pseudo random numbers (xorshift), so that all
+// implementations see the same sequence.
+class Random {
+public:
+    Random(): m_state(2463534242u) { }
+    std::size_t operator() (std::size_t n)
+    {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state % n;
+    }
+private:
+    unsigned m_state;
+};
+
+// The baseline: a plain vector of std::function, without disconnection.
+template <typename Signature>
+class FunctionVector {
+public:
+    template <typename F>
+    void connect(F const& f) { m_functions.push_back(f); }
+
+    template <typename... Args>
+    void operator() (Args const&... args)
+    {
+        for (auto const& f: m_functions)
+            f(args...);
+    }
+
+private:
+    std::vector<std::function<Signature>> m_functions;
 };
 
-struct D1: public B {
-    virtual int operator() (int i) const { return ++i; }
+struct Options {
+    Options(): repetitions(5), samples(100) { }
+    unsigned repetitions;
+    unsigned samples; // per repetition
+    std::string filter;
+    std::string jsonPath;
 };
 
-struct D2: public B {
-    virtual int operator() (int i) const { return i *= 2; }
+struct Result {
+    std::string scenario;
+    std::string implementation;
+    double slotsPerEmission;
+    std::vector<double> samples; // batch mean ns per emission, all repetitions
+    std::vector<double> repetitionMedians;
 };
 
-} // anonymous namespace
+double percentile(std::vector<double> sorted, double p)
+{
+    std::sort(sorted.begin(), sorted.end());
+    std::size_t rank = static_cast<std::size_t>(p * sorted.size() + 0.999999);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
 
-static int foo(int i)
+double mean(std::vector<double> const& values)
 {
-    return ++i;
+    return std::accumulate(values.begin(), values.end(), 0.0) / values.size();
 }
 
-static void voidfoo(int i)
+// Times batches of calls of emit(), each of which performs emissionsPerCall
+// emissions, and appends the time per emission of each batch to samples.
+// The batch size is chosen so that a sample takes about 100 microseconds.
+template <typename F>
+void measure(F& emit, unsigned emissionsPerCall, unsigned numSamples,
+             std::vector<double>& samples)
 {
-    ++i;
+    emit(); // warm up
+    auto start = clock_type::now();
+    emit();
+    double const nsPerCall = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_type::now() - start).count());
+    unsigned const batch = std::max(1u, static_cast<unsigned>(100000 / (nsPerCall + 1)));
+
+    for (unsigned s = 0; s < numSamples; ++s) {
+        start = clock_type::now();
+        for (unsigned i = 0; i < batch; ++i)
+            emit();
+        auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_type::now() - start).count();
+        samples.push_back(static_cast<double>(ns) / batch / emissionsPerCall);
+    }
 }
 
-template <typename ContainerT>
-void test_container(unsigned num_sigs, unsigned num_runs)
+// A scenario sets up the signals for one repetition and measures them.
+typedef std::function<void(unsigned numSamples, std::vector<double>& samples)> repetition_type;
+
+struct Benchmark {
+    std::string scenario;
+    std::string implementation;
+    double slotsPerEmission;
+    repetition_type repeat;
+};
+
+// Many signals with few slots each, e.g. per-object member signals.
+template <typename SignalT>
+void manySignalsFewSlots(unsigned numSamples, std::vector<double>& samples)
 {
-    cout << "Preparing...";
-    ContainerT signals(num_sigs, &foo);
+    unsigned const numSignals = 10000, numSlots = 2;
+    std::deque<SignalT> signals(numSignals);
+    for (auto& sig: signals)
+        for (unsigned i = 0; i < numSlots; ++i)
+            sig.connect(&sink);
+    auto emit = [&signals]() {
+        for (auto& sig: signals)
+            sig(1);
+    };
+    measure(emit, numSignals, numSamples, samples);
+}
 
-    cout << "\rRunning...     \r";
-    boost::timer::auto_cpu_timer t;
-    for (unsigned r = 0; r < num_runs; ++r)
-        for (auto it = signals.cbegin(), end = signals.cend(); it != end; ++it)
-            (*it)(2);
+// Few signals with many slots each, e.g. global events.
+template <typename SignalT>
+void fewSignalsManySlots(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numSignals = 4, numSlots = 2500;
+    std::deque<SignalT> signals(numSignals);
+    for (auto& sig: signals)
+        for (unsigned i = 0; i < numSlots; ++i)
+            sig.connect(&sink);
+    auto emit = [&signals]() {
+        for (auto& sig: signals)
+            sig(1);
+    };
+    measure(emit, numSignals, numSamples, samples);
 }
 
+// Each emission is preceded by connecting a slot and disconnecting a
+// randomly chosen one.
 template <typename SignalT>
-void test_signal(unsigned num_sigs, unsigned num_runs)
+void connectDisconnectChurn(unsigned numSamples, std::vector<double>& samples)
 {
-    cout << "Preparing...";
+    unsigned const numSlots = 1000;
     SignalT sig;
-    for (unsigned i = 0; i < num_sigs; ++i)
-        sig.connect(&foo);
-    cout << "\rRunning...     \r";
-    boost::timer::auto_cpu_timer t;
-    for (unsigned r = 0; r < num_runs; ++r)
-        sig(2);
+    std::vector<decltype(sig.connect(&sink))> connections;
+    for (unsigned i = 0; i < numSlots; ++i)
+        connections.push_back(sig.connect(&sink));
+    Random random;
+    auto emit = [&]() {
+        std::size_t const i = random(connections.size());
+        connections[i].disconnect();
+        connections[i] = sig.connect(&sink);
+        sig(1);
+    };
+    measure(emit, 1, numSamples, samples);
 }
 
+// A fifth of the slots is disconnected, which stays below the compaction
+// threshold of ssig, so that emissions skip the dead slots.
+template <typename SignalT>
+void mixedLiveAndDeadSlots(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numSlots = 10000;
+    SignalT sig;
+    std::vector<decltype(sig.connect(&sink))> connections;
+    for (unsigned i = 0; i < numSlots; ++i)
+        connections.push_back(sig.connect(&sink));
+    for (unsigned i = 0; i < numSlots; i += 5)
+        connections[i].disconnect();
+    auto emit = [&sig]() { sig(1); };
+    measure(emit, 1, numSamples, samples);
+}
 
-int main(int argc, char* argv[])
+struct Receiver {
+    Receiver(): total(0) { }
+    void receive(int i) { total += i; }
+    int total;
+};
+
+// Slots calling a member function of a different receiver each.
+template <typename SignalT>
+void memberFunctionSlots(unsigned numSamples, std::vector<double>& samples)
 {
-#ifndef NDEBUG
-    cout << "DEBUG version!\n";
-#endif
-    if (argc < 3 || argc > 4)
-    {
-        std::cerr << "Arguments: number_of_signals number_of_runs [skip Boost.Signals* 0|1].\n";
-        return EXIT_FAILURE;
+    unsigned const numSlots = 1000;
+    std::vector<Receiver> receivers(numSlots);
+    SignalT sig;
+    for (auto& receiver: receivers) {
+        Receiver* const r = &receiver;
+        sig.connect([r](int i) { r->receive(i); });
     }
-    const unsigned num_sigs = atol(argv[1]), num_runs = atol(argv[2]);
-    bool skip_boost = false;
-    if (argc == 4)
-    {
-        skip_boost = atol(argv[3]) ? true : false;
+    auto emit = [&sig]() { sig(1); };
+    measure(emit, 1, numSamples, samples);
+    for (auto const& receiver: receivers)
+        g_sink += receiver.total;
+}
+
+struct TrackedReceiver: ssig::Trackable, Receiver { };
+
+// Slots which are disconnected when their receiver is destroyed: ssig's
+// Trackable, which needs no check per call.
+void trackedSlotsTrackable(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numSlots = 1000;
+    std::vector<TrackedReceiver> receivers(numSlots);
+    ssig::Signal<void(int)> sig;
+    for (auto& receiver: receivers) {
+        TrackedReceiver* const r = &receiver;
+        sig.connect(receiver, [r](int i) { r->receive(i); });
     }
-    cout << "Benchmark with " << num_sigs << " signals and " << num_runs << " runs:\n";
-    boost::timer::auto_cpu_timer total;
-    try
-    {
-        cout << "Test 1: std::vector of function pointers\n";
-        typedef int(*fn_t)(int);
-        test_container<std::vector<fn_t> >(num_sigs, num_runs);
-
-        cout << "Test 2: std::vector of std::function\n";
-        test_container<std::vector<std::function<int(int)> > >(num_sigs, num_runs);
-
-        cout << "Test 3: std::vector of boost::function\n";
-        test_container<std::vector<boost::function<int(int)> > >(num_sigs, num_runs);
-
-        if (!skip_boost)
-        {
-            cout << "Test 4: Boost.Signals\n";
-            test_signal<boost::signal<int(int)>>(num_sigs, num_runs);
-            cout << "Test 5: Boost.Signals2\n";
-            test_signal<boost::signals2::signal<int(int)>>(num_sigs, num_runs);
-        }
+    auto emit = [&sig]() { sig(1); };
+    measure(emit, 1, numSamples, samples);
+    for (auto const& receiver: receivers)
+        g_sink += receiver.total;
+}
+
+// As above, with Boost.Signals2 tracking a std::shared_ptr to each receiver
+// with track_foreign(), which locks a weak_ptr for each call.
+void trackedSlotsSignals2(unsigned numSamples, std::vector<double>& samples)
+{
+    typedef boost::signals2::signal<void(int)> signal_type;
+    unsigned const numSlots = 1000;
+    std::vector<std::shared_ptr<Receiver>> receivers;
+    signal_type sig;
+    for (unsigned i = 0; i < numSlots; ++i) {
+        receivers.push_back(std::make_shared<Receiver>());
+        Receiver* const r = receivers.back().get();
+        sig.connect(signal_type::slot_type([r](int i) { r->receive(i); })
+            .track_foreign(receivers.back()));
+    }
+    auto emit = [&sig]() { sig(1); };
+    measure(emit, 1, numSamples, samples);
+    for (auto const& receiver: receivers)
+        g_sink += receiver->total;
+}
 
+typedef ssig::MemberSlot<Receiver, void(int), &Receiver::receive> receiver_slot;
 
-        cout << "Test 6: ssig\n";
-        test_signal<ssig::Signal<int(int)>>(num_sigs, num_runs);
+// As above, but with a TypedSignal, which calls the slots directly.
+void memberFunctionSlotsTyped(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numSlots = 1000;
+    std::vector<Receiver> receivers(numSlots);
+    ssig::TypedSignal<void(int), receiver_slot> sig;
+    for (auto& receiver: receivers)
+        sig.connect(receiver_slot(receiver));
+    auto emit = [&sig]() { sig(1); };
+    measure(emit, 1, numSamples, samples);
+    for (auto const& receiver: receivers)
+        g_sink += receiver.total;
+}
 
-        {
-            cout << "Test 6a: ssig+void\n";
-            cout << "Preparing...";
-            ssig::Signal<void(int)> sig;
-            for (unsigned i = 0; i < num_sigs; ++i)
-                sig.connect(&voidfoo);
-            cout << "\rRunning...     \r";
-            boost::timer::auto_cpu_timer t;
-            for (unsigned r = 0; r < num_runs; ++r)
-                sig(2);
+struct VirtualReceiverBase {
+    virtual ~VirtualReceiverBase() { }
+    virtual void receive(int i) = 0;
+};
+
+struct VirtualReceiver: VirtualReceiverBase {
+    VirtualReceiver(): total(0) { }
+    virtual void receive(int i) { total += i; }
+    int total;
+};
+
+// As above, but with a virtual function call on each receiver.
+void memberFunctionSlotsVirtual(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numSlots = 1000;
+    std::vector<VirtualReceiver> receivers(numSlots);
+    std::vector<VirtualReceiverBase*> slots;
+    for (auto& receiver: receivers)
+        slots.push_back(&receiver);
+    auto emit = [&slots]() {
+        for (auto slot: slots)
+            slot->receive(1);
+    };
+    measure(emit, 1, numSamples, samples);
+    for (auto const& receiver: receivers)
+        g_sink += receiver.total;
+}
+
+struct Point {
+    double x, y, z;
+};
+
+typedef void heavy_signature(
+    std::string const&, std::vector<int> const&, Point const&, double, int, int);
+
+void heavySink(std::string const& name, std::vector<int> const& values,
+               Point const& p, double d, int i, int j)
+{
+    g_sink += name.size() + values.size() + static_cast<unsigned>(p.x + d) + i + j;
+}
+
+// A signature with many arguments, some of which are expensive to copy.
+template <typename SignalT>
+void argumentHeavySignature(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numSlots = 1000;
+    SignalT sig;
+    for (unsigned i = 0; i < numSlots; ++i)
+        sig.connect(&heavySink);
+    std::string const name("a name which does not fit into a small string buffer");
+    std::vector<int> const values(16, 1);
+    Point const p = { 1, 2, 3 };
+    auto emit = [&]() { sig(name, values, p, 4.0, 5, 6); };
+    measure(emit, 1, numSamples, samples);
+}
+
+// 100 events delivered to 1000 slots, by invoking the signal in a loop or
+// with emitBatch(), which calls each slot for all events in turn.
+void batchEmissionLoop(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numSlots = 1000, numEvents = 100;
+    ssig::Signal<void(int)> sig;
+    for (unsigned i = 0; i < numSlots; ++i)
+        sig.connect(&sink);
+    std::vector<int> const events(numEvents, 1);
+    auto emit = [&]() {
+        for (int event: events)
+            sig(event);
+    };
+    measure(emit, numEvents, numSamples, samples);
+}
+
+void batchEmissionBatch(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numSlots = 1000, numEvents = 100;
+    ssig::Signal<void(int)> sig;
+    for (unsigned i = 0; i < numSlots; ++i)
+        sig.connect(&sink);
+    std::vector<std::tuple<int>> const events(numEvents, std::make_tuple(1));
+    auto emit = [&]() { sig.emitBatch(events); };
+    measure(emit, numEvents, numSamples, samples);
+}
+
+// Slots interested in one of 1000 keys each, two per key; the key is the
+// first argument. With a plain signal, every slot compares the key.
+void keyedDispatchFiltered(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numKeys = 1000, slotsPerKey = 2;
+    ssig::Signal<void(unsigned, int)> sig;
+    for (unsigned key = 0; key < numKeys; ++key) {
+        for (unsigned i = 0; i < slotsPerKey; ++i) {
+            sig.connect([key](unsigned k, int i) {
+                if (k == key)
+                    sink(i);
+            });
         }
+    }
+    Random random;
+    auto emit = [&]() { sig(static_cast<unsigned>(random(numKeys)), 1); };
+    measure(emit, 1, numSamples, samples);
+}
+
+// The keys are multiples of Stride, e.g. ids allocated in blocks.
+template <unsigned Stride>
+void keyedDispatchKeyed(unsigned numSamples, std::vector<double>& samples)
+{
+    unsigned const numKeys = 1000, slotsPerKey = 2;
+    ssig::KeyedSignal<unsigned, void(unsigned, int)> sig;
+    for (unsigned key = 0; key < numKeys; ++key) {
+        for (unsigned i = 0; i < slotsPerKey; ++i)
+            sig.connect(key * Stride, [](unsigned, int i) { sink(i); });
+    }
+    Random random;
+    auto emit = [&]() { sig(static_cast<unsigned>(random(numKeys)) * Stride, 1); };
+    measure(emit, 1, numSamples, samples);
+}
+
+std::vector<Benchmark> benchmarks()
+{
+    typedef ssig::Signal<void(int)> ssig_t;
+    typedef boost::signals2::signal<void(int)> signals2_t;
+    typedef FunctionVector<void(int)> functions_t;
+    char const* const ssig = "ssig";
+    char const* const signals2 = "boost::signals2";
+    char const* const functions = "std::vector<std::function>";
+
+    Benchmark const list[] = {
+        { "many_signals_few_slots", ssig, 2, &manySignalsFewSlots<ssig_t> },
+        { "many_signals_few_slots", signals2, 2, &manySignalsFewSlots<signals2_t> },
+        { "many_signals_few_slots", functions, 2, &manySignalsFewSlots<functions_t> },
+        { "few_signals_many_slots", ssig, 2500, &fewSignalsManySlots<ssig_t> },
+        { "few_signals_many_slots", signals2, 2500, &fewSignalsManySlots<signals2_t> },
+        { "few_signals_many_slots", functions, 2500, &fewSignalsManySlots<functions_t> },
+        { "connect_disconnect_churn", ssig, 1000, &connectDisconnectChurn<ssig_t> },
+        { "connect_disconnect_churn", signals2, 1000, &connectDisconnectChurn<signals2_t> },
+        { "mixed_live_and_dead_slots", ssig, 8000, &mixedLiveAndDeadSlots<ssig_t> },
+        { "mixed_live_and_dead_slots", signals2, 8000, &mixedLiveAndDeadSlots<signals2_t> },
+        { "member_function_slots", ssig, 1000, &memberFunctionSlots<ssig_t> },
+        { "member_function_slots", signals2, 1000, &memberFunctionSlots<signals2_t> },
+        { "member_function_slots", functions, 1000, &memberFunctionSlots<functions_t> },
+        { "member_function_slots", "ssig::TypedSignal", 1000, &memberFunctionSlotsTyped },
+        { "member_function_slots", "virtual function calls", 1000, &memberFunctionSlotsVirtual },
+        { "tracked_slots", "ssig::Trackable", 1000, &trackedSlotsTrackable },
+        { "tracked_slots", "boost::signals2 track_foreign", 1000, &trackedSlotsSignals2 },
+        { "batch_emission", "ssig, operator() loop", 1000, &batchEmissionLoop },
+        { "batch_emission", "ssig::Signal::emitBatch", 1000, &batchEmissionBatch },
+        { "argument_heavy_signature", ssig, 1000,
+            &argumentHeavySignature<ssig::Signal<heavy_signature>> },
+        { "argument_heavy_signature", signals2, 1000,
+            &argumentHeavySignature<boost::signals2::signal<heavy_signature>> },
+        { "argument_heavy_signature", functions, 1000,
+            &argumentHeavySignature<FunctionVector<heavy_signature>> },
+        { "keyed_dispatch", "ssig, filtering slots", 2, &keyedDispatchFiltered },
+        { "keyed_dispatch", "ssig::KeyedSignal", 2, &keyedDispatchKeyed<1> },
+        { "keyed_dispatch", "ssig::KeyedSignal, stride 4096", 2, &keyedDispatchKeyed<4096> }
+    };
+    return std::vector<Benchmark>(std::begin(list), std::end(list));
+}
+
+void writeStats(std::ostream& out, std::vector<double> const& values, double divisor)
+{
+    std::vector<double> scaled(values);
+    for (auto& v: scaled)
+        v /= divisor;
+    out << "{\"min\": " << *std::min_element(scaled.begin(), scaled.end())
+        << ", \"p50\": " << percentile(scaled, 0.5)
+        << ", \"p99\": " << percentile(scaled, 0.99)
+        << ", \"mean\": " << mean(scaled) << '}';
+}
 
-        {
-            cout << "Test 7: virtual function calls\n";
-            cout << "Preparing...";
-            B const& d1 = D1();
-            B const& d2 = D2();
-            std::vector<B const*> signals;
-            signals.reserve(num_sigs);
-            for (unsigned i = 0; i < num_sigs; ++i) {
-                signals.push_back(rand() % 2 ? &d1 : &d2);
-            }
-            cout << "\rRunning...     \r";
-            boost::timer::auto_cpu_timer t;
-            for (unsigned r = 0; r < num_runs; ++r)
-                for (auto it = signals.cbegin(), end = signals.cend(); it != end; ++it)
-                    (**it)(2);
+void writeJson(std::ostream& out, Options const& options, std::vector<Result> const& results)
+{
+    out << "{\n  \"library\": \"ssig\",\n";
+#ifdef __VERSION__
+    out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+#ifdef NDEBUG
+    out << "  \"debug\": false,\n";
+#else
+    out << "  \"debug\": true,\n";
+#endif
+    out << "  \"repetitions\": " << options.repetitions << ",\n"
+        << "  \"samples_per_repetition\": " << options.samples << ",\n"
+        << "  \"sample\": \"mean of a batch of emissions lasting about 100 us\",\n"
+        << "  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        Result const& r = results[i];
+        out << (i ? ",\n" : "\n")
+            << "    {\"scenario\": \"" << r.scenario << "\", "
+            << "\"implementation\": \"" << r.implementation << "\", "
+            << "\"slots_per_emission\": " << r.slotsPerEmission << ",\n"
+            << "     \"batch_mean_ns_per_emission\": ";
+        writeStats(out, r.samples, 1);
+        out << ",\n     \"batch_mean_ns_per_slot\": ";
+        writeStats(out, r.samples, r.slotsPerEmission);
+        out << ",\n     \"repetition_p50_batch_mean_ns_per_emission\": [";
+        for (std::size_t j = 0; j < r.repetitionMedians.size(); ++j)
+            out << (j ? ", " : "") << r.repetitionMedians[j];
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        bool const hasValue = i + 1 < argc;
+        if (!std::strcmp(argv[i], "--repetitions") && hasValue)
+            options.repetitions = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--samples") && hasValue)
+            options.samples = std::max(1, std::atoi(argv[++i]));
+        else if (!std::strcmp(argv[i], "--filter") && hasValue)
+            options.filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--json") && hasValue)
+            options.jsonPath = argv[++i];
+        else
+            return false;
+    }
+    return true;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "Arguments: [--repetitions N] [--samples N] [--filter TEXT] [--json FILE]\n";
+        return EXIT_FAILURE;
+    }
+#ifndef NDEBUG
+    std::cout << "DEBUG version!\n";
+#endif
+
+    // Percentiles over samples, each the mean ns per emission of a batch.
+    std::cout << "Percentiles of batch means (about 100 us per batch), not of single emissions\n"
+              << std::left << std::setw(28) << "scenario" << std::setw(28) << "implementation"
+              << std::right << std::setw(14) << "p50 ns/emit" << std::setw(14) << "p99 ns/emit"
+              << std::setw(14) << "p50 ns/slot" << '\n' << std::fixed << std::setprecision(2);
+
+    std::vector<Result> results;
+    for (auto const& benchmark: benchmarks()) {
+        if (!options.filter.empty()
+            && (benchmark.scenario + ' ' + benchmark.implementation).find(options.filter)
+                == std::string::npos)
+            continue;
+        Result result;
+        result.scenario = benchmark.scenario;
+        result.implementation = benchmark.implementation;
+        result.slotsPerEmission = benchmark.slotsPerEmission;
+        for (unsigned r = 0; r < options.repetitions; ++r) {
+            std::vector<double> samples;
+            benchmark.repeat(options.samples, samples);
+            result.repetitionMedians.push_back(percentile(samples, 0.5));
+            result.samples.insert(result.samples.end(), samples.begin(), samples.end());
         }
+        double const p50 = percentile(result.samples, 0.5);
+        std::cout << std::left << std::setw(28) << result.scenario
+                  << std::setw(28) << result.implementation << std::right
+                  << std::setw(14) << p50
+                  << std::setw(14) << percentile(result.samples, 0.99)
+                  << std::setw(14) << p50 / result.slotsPerEmission << std::endl;
+        results.push_back(result);
     }
-    catch (const std::bad_alloc& e)
-    {
-        std::cerr << e.what() << "; try decreasing number_of_signals\n";
+
+    if (!options.jsonPath.empty()) {
+        std::ofstream json(options.jsonPath.c_str());
+        writeJson(json, options, results);
+        if (!json) {
+            std::cerr << "Could not write " << options.jsonPath << '\n';
+            return EXIT_FAILURE;
+        }
     }
-    cout << "Total time (incl. preparation):"; // destruction of total timer prints space + results
+    return g_sink == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
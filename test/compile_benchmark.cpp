@@ -0,0 +1,62 @@
+// Part of ssig -- Copyright (c) Christian Neumüller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+// Compile time benchmark: a translation unit which, like a typical user of
+// ssig, includes it and instantiates a few signals. The ssig_compile_benchmark
+// target prints how long compiling it takes.
+
+#include <ssig.hpp>
+
+#include <string>
+
+namespace {
+
+struct Widget {
+    void resized(int, int) { }
+    void renamed(std::string const&) { }
+};
+
+void onFrame() { }
+void onKey(int, bool) { }
+void onMove(float, float, float) { }
+void onHit(int, int, float, std::string const&) { }
+int onQuery(int, int, int, int, int) { return 0; }
+
+} // anonymous namespace
+
+int main()
+{
+    Widget w;
+
+    ssig::Signal<void()> frame;
+    ssig::ScopedConnection<void()> c1 = frame.connect(&onFrame);
+    frame();
+
+    ssig::Signal<void(int, bool)> key;
+    key.connect(&onKey);
+    key(1, true);
+
+    ssig::Signal<void(int, int)> resized;
+    resized.connect([&w](int x, int y) { w.resized(x, y); });
+    resized(640, 480);
+
+    ssig::Signal<void(std::string const&)> renamed;
+    renamed.connect([&w](std::string const& name) { w.renamed(name); });
+    renamed("widget");
+
+    ssig::Signal<void(float, float, float)> move;
+    move.connect(&onMove);
+    move(1.f, 2.f, 3.f);
+
+    ssig::Signal<void(int, int, float, std::string const&)> hit;
+    hit.connect(&onHit);
+    hit(1, 2, 3.f, "hit");
+
+    ssig::Signal<int(int, int, int, int, int)> query;
+    ssig::Connection<int(int, int, int, int, int)> c2 = query.connect(&onQuery);
+    int const result = query(1, 2, 3, 4, 5) + c2.invokeSlot(1, 2, 3, 4, 5);
+    c2.disconnect();
+
+    return result;
+}
@@ -0,0 +1,140 @@
+// Part of ssig -- Copyright (c) Christian Neumüller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+// The statistics are enabled for all of ssig, so they are tested in a
+// separate program.
+#define SSIG_ENABLE_SLOT_TIMING
+
+#include "ssig.hpp"
+#include "ssig_queued.hpp"
+#include "ssig_keyed.hpp"
+
+#define BOOST_TEST_MODULE SsigStatsTest
+#include <boost/test/unit_test.hpp>
+
+#include <cstring>
+#include <sstream>
+
+using namespace ssig; // Don't do this at home.
+
+namespace {
+
+SignalStatsSnapshot const* find(std::vector<SignalStatsSnapshot> const& all, char const* name)
+{
+    for (auto const& s: all) {
+        if (s.name && !std::strcmp(s.name, name))
+            return &s;
+    }
+    return nullptr;
+}
+
+std::uint64_t sum(SignalStatsSnapshot const& s)
+{
+    std::uint64_t n = 0;
+    for (auto const c: s.latencyHistogram)
+        n += c;
+    return n;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(stats)
+
+BOOST_AUTO_TEST_CASE(emission_stats)
+{
+    Signal<int(int)> s;
+    s.setName("s");
+    Connection<int(int)> c1 = s.connect([](int i) { return i; });
+    s.connect([](int i) { return i + 1; });
+    s(1);
+    s(2);
+    c1.invokeSlot(3);
+    Sum<int> sum;
+    s.combine(sum, 4);
+    c1.disconnect();
+    s.compact();
+
+    auto const all = StatsRegistry::instance().snapshot();
+    SignalStatsSnapshot const* const stats = find(all, "s");
+    BOOST_REQUIRE(stats);
+    BOOST_CHECK_EQUAL(stats->emissions, 3u);
+    BOOST_CHECK_EQUAL(stats->slotCalls, 7u);
+    BOOST_CHECK_EQUAL(stats->connects, 2u);
+    BOOST_CHECK_EQUAL(stats->disconnects, 1u);
+    BOOST_CHECK_EQUAL(stats->liveSlots(), 1u);
+    BOOST_CHECK_EQUAL(stats->sweeps, 1u);
+    BOOST_CHECK_EQUAL(stats->sweptSlots, 1u);
+    BOOST_CHECK_EQUAL(::sum(*stats), 7u);
+}
+
+BOOST_AUTO_TEST_CASE(queued_stats)
+{
+    QueuedSignal<void(int)> q;
+    int n = 0;
+    ScopedConnection<void(int)> c = q.connect([&n](int i) { n += i; });
+    q(1);
+    q(2);
+    q.drain();
+    BOOST_CHECK_EQUAL(n, 3);
+    // A drained batch is one emission.
+    bool found = false;
+    for (auto const& s: StatsRegistry::instance().snapshot()) {
+        if (s.slotCalls == 2u && s.emissions == 1u)
+            found = true;
+    }
+    BOOST_CHECK(found);
+}
+
+BOOST_AUTO_TEST_CASE(compact_signal_name)
+{
+    CompactSignal<void()> s;
+    s.setName("compact");
+    BOOST_CHECK(!find(StatsRegistry::instance().snapshot(), "compact")); // no table yet
+    ScopedConnection<void()> c = s.connect([]() { });
+    s();
+    auto const all = StatsRegistry::instance().snapshot();
+    SignalStatsSnapshot const* const stats = find(all, "compact");
+    BOOST_REQUIRE(stats);
+    BOOST_CHECK_EQUAL(stats->emissions, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(keyed_stats)
+{
+    KeyedSignal<int, void(int)> s;
+    s.setName("keyed");
+    s.connect(1, [](int) { });
+    s.connectAny([](int) { });
+    s(1);
+    s(2);
+    // Each invocation is one emission, however many tables it calls.
+    std::uint64_t emissions = 0, slotCalls = 0;
+    for (auto const& stats: StatsRegistry::instance().snapshot()) {
+        if (stats.name && !std::strcmp(stats.name, "keyed")) {
+            emissions += stats.emissions;
+            slotCalls += stats.slotCalls;
+        }
+    }
+    BOOST_CHECK_EQUAL(emissions, 2u);
+    BOOST_CHECK_EQUAL(slotCalls, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(registry)
+{
+    std::size_t const numSignals = StatsRegistry::instance().snapshot().size();
+    Connection<void()> outliving;
+    {
+        Signal<void()> s;
+        s.setName("registered");
+        outliving = s.connect([]() { });
+        BOOST_CHECK_EQUAL(StatsRegistry::instance().snapshot().size(), numSignals + 1);
+
+        std::ostringstream dump;
+        StatsRegistry::instance().dump(dump);
+        BOOST_CHECK(dump.str().find("registered") != std::string::npos);
+    }
+    // The slot table is kept alive by the connection, but the signal is gone.
+    BOOST_CHECK_EQUAL(StatsRegistry::instance().snapshot().size(), numSignals);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,10 +3,26 @@
 // See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
 
 #include "ssig.hpp"
+#include "ssig_concurrent.hpp"
+#include "ssig_queued.hpp"
+#include "ssig_keyed.hpp"
+#include "ssig_mailbox.hpp"
+#include "ssig_parallel.hpp"
 
 #define BOOST_TEST_MODULE SsigTest
 #include <boost/test/unit_test.hpp>
 
+#include <boost/smart_ptr/make_shared.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <forward_list>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 using namespace ssig; // Don't do this at home.
 
 BOOST_AUTO_TEST_SUITE(nullary_signals)
@@ -456,3 +472,1493 @@ BOOST_AUTO_TEST_CASE(scoped_connection_bin)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(compact_signals)
+
+static_assert(sizeof(Signal<void(int)>) == sizeof(void*),
+    "Signal must be one pointer wide");
+static_assert(sizeof(CompactSignal<void(int)>) == sizeof(void*),
+    "CompactSignal must be one pointer wide");
+
+namespace {
+
+struct Entity {
+    SSIG_DEFINE_COMPACT_MEMBERSIGNAL(moved, void(int))
+    SSIG_DEFINE_COMPACT_MEMBERSIGNAL(damaged, int(int))
+
+public:
+    void move(int i) { m_sig_moved(i); }
+    int damage(int i) { return m_sig_damaged(i); }
+};
+
+struct Button {
+    SSIG_DEFINE_MEMBERSIGNAL(clicked, void(int))
+
+public:
+    void click(int i) { m_sig_clicked(i); }
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(compact_signal)
+{
+    CompactSignal<int(int)> s;
+    BOOST_CHECK(s.empty());
+    BOOST_CHECK_THROW(s(1), SsigError);
+    Connection<int(int)> c;
+    {
+        ScopedConnection<int(int)> c1 = s.connect([](int i) { return i + 1; });
+        c = s.connect([](int i) { return i + 2; });
+        BOOST_CHECK_EQUAL(s.size(), 2u);
+        BOOST_CHECK_EQUAL(s(1), 2);
+        BOOST_CHECK_EQUAL(c.invokeSlot(1), 3);
+    }
+    BOOST_CHECK_EQUAL(s(1), 3);
+    c.disconnect();
+    BOOST_CHECK(s.empty());
+    BOOST_CHECK_THROW(s(1), SsigError);
+
+    Connection<void()> outliving;
+    {
+        CompactSignal<void()> v;
+        v(); // nothing connected yet: no slot table
+        outliving = v.connect([&v]() { BOOST_CHECK_THROW(v(), SsigError); });
+        v();
+    }
+    BOOST_CHECK(!outliving.isConnected());
+}
+
+BOOST_AUTO_TEST_CASE(compact_signal_allocator)
+{
+    SlotPool pool;
+    CompactSignal<void(), Delegate<void()>, PoolAllocator<char>> s(pool);
+    BOOST_CHECK_EQUAL(pool.capacity(), 0u); // no table before the first connect
+    int calls = 0;
+    auto c = s.connect([&calls]() { ++calls; });
+    BOOST_CHECK(pool.capacity() > 0);
+    s();
+    BOOST_CHECK_EQUAL(calls, 1);
+
+    CompactSignal<void(), Delegate<void()>, PoolAllocator<char>> moved(std::move(s));
+    moved();
+    BOOST_CHECK_EQUAL(calls, 2);
+    c.disconnect();
+    BOOST_CHECK(moved.empty());
+}
+
+BOOST_AUTO_TEST_CASE(compact_member_signal)
+{
+    Entity e;
+    e.move(1);
+    BOOST_CHECK_THROW(e.damage(1), SsigError);
+    int moved = 0;
+    ScopedConnection<void(int)> c1 = e.connect_moved([&moved](int i) { moved += i; });
+    ScopedConnection<int(int)> c2 = e.connect_damaged([](int i) { return 2 * i; });
+    e.move(3);
+    BOOST_CHECK_EQUAL(moved, 3);
+    BOOST_CHECK_EQUAL(e.damage(5), 10);
+}
+
+BOOST_AUTO_TEST_CASE(moving_signals)
+{
+    int sum = 0;
+    Signal<void(int)> s;
+    auto c = s.connect([&sum](int i) { sum += i; });
+    Signal<void(int)> t(std::move(s));
+    BOOST_CHECK(s.empty());
+    s(1);
+    t(2);
+    BOOST_CHECK_EQUAL(sum, 2);
+    BOOST_CHECK(c.isConnected());
+
+    // Assignment disconnects the slots of the target.
+    Signal<void(int)> u;
+    auto d = u.connect([&sum](int i) { sum += 100 * i; });
+    u = std::move(t);
+    BOOST_CHECK(!d.isConnected());
+    BOOST_CHECK(c.isConnected());
+    BOOST_CHECK(t.empty());
+    u(3);
+    BOOST_CHECK_EQUAL(sum, 5);
+    t.connect([&sum](int i) { sum += 10 * i; });
+    t(1);
+    BOOST_CHECK_EQUAL(sum, 15);
+    c.disconnect();
+    BOOST_CHECK(u.empty());
+
+    Button b1;
+    ScopedConnection<void(int)> clicked = b1.connect_clicked([&sum](int i) { sum = i; });
+    Button b2(std::move(b1));
+    b2.click(7);
+    BOOST_CHECK_EQUAL(sum, 7);
+
+    CompactSignal<void(int)> cs;
+    auto e = cs.connect([&sum](int i) { sum = -i; });
+    CompactSignal<void(int)> ct;
+    ct = std::move(cs);
+    BOOST_CHECK(cs.empty());
+    cs(1);
+    ct(2);
+    BOOST_CHECK_EQUAL(sum, -2);
+    BOOST_CHECK(e.isConnected());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(connection_groups)
+
+BOOST_AUTO_TEST_CASE(connection_group)
+{
+    Signal<void(int)> s1;
+    CompactSignal<int()> s2;
+    int called = 0;
+    {
+        ConnectionGroup group;
+        s1.connect(group, [&called](int i) { called += i; });
+        s1.connect(group, [&called](int i) { called += 2 * i; });
+        s2.connect(group, []() { return 1; });
+        Connection<void(int)> c = s1.connect([&called](int) { ++called; });
+        group.add(c);
+        BOOST_CHECK_EQUAL(group.size(), 4u);
+        BOOST_CHECK_EQUAL(s1.size(), 3u);
+        s1(1);
+        BOOST_CHECK_EQUAL(called, 4);
+
+        c.disconnect(); // disconnecting individually is fine
+        group.disconnectAll();
+        BOOST_CHECK(group.empty());
+        BOOST_CHECK(s1.empty());
+        BOOST_CHECK(s2.empty());
+
+        s1.connect(group, [&called](int i) { called += i; });
+        BOOST_CHECK_EQUAL(s1.size(), 1u);
+    }
+    BOOST_CHECK(s1.empty());
+}
+
+BOOST_AUTO_TEST_CASE(connection_group_outlives_signal)
+{
+    ConnectionGroup group;
+    {
+        Signal<void()> s;
+        s.connect(group, []() { });
+    }
+    group.disconnectAll();
+    BOOST_CHECK(group.empty());
+}
+
+BOOST_AUTO_TEST_CASE(connection_group_removes_disconnected)
+{
+    Signal<void()> s;
+    ConnectionGroup group;
+    for (int i = 0; i < 100; ++i)
+        s.connect(group, []() { }).disconnect();
+    BOOST_CHECK(group.size() < 100u);
+    BOOST_CHECK(s.empty());
+}
+
+namespace {
+
+struct Receiver: ssig::Trackable {
+    Receiver(): received(0) { }
+    void receive(int i) { received += i; }
+    int received;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(tracked_slots)
+{
+    Signal<void(int)> s;
+    Receiver kept;
+    s.connect(kept, [&kept](int i) { kept.receive(i); });
+    Connection<void(int)> c;
+    {
+        Receiver r;
+        c = s.connect(r, [&r](int i) { r.receive(i); });
+        s(1);
+        BOOST_CHECK_EQUAL(r.received, 1);
+
+        Receiver copy(r);
+        BOOST_CHECK(copy.trackedConnections().empty());
+        BOOST_CHECK_EQUAL(s.size(), 2u);
+    }
+    BOOST_CHECK(!c.isConnected());
+    BOOST_CHECK_EQUAL(s.size(), 1u);
+    s(2);
+    BOOST_CHECK_EQUAL(kept.received, 3);
+
+    kept.disconnectTracked();
+    BOOST_CHECK(s.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(keyed_signals)
+
+BOOST_AUTO_TEST_CASE(keyed_dispatch)
+{
+    KeyedSignal<int, void(int, std::string const&)> s;
+    std::vector<int> calls;
+    std::vector<Connection<void(int, std::string const&)>> connections;
+    for (int key = 0; key < 100; ++key) {
+        connections.push_back(s.connect(key, [&calls, key](int k, std::string const&) {
+            BOOST_CHECK_EQUAL(k, key);
+            calls.push_back(key);
+        }));
+    }
+    s(42, "x");
+    BOOST_REQUIRE_EQUAL(calls.size(), 1u);
+    BOOST_CHECK_EQUAL(calls[0], 42);
+    s(1000, "x"); // no slots for this key
+    BOOST_CHECK_EQUAL(calls.size(), 1u);
+
+    ScopedConnection<void(int, std::string const&)> any =
+        s.connectAny([&calls](int, std::string const&) { calls.push_back(-1); });
+    calls.clear();
+    s(7, "x");
+    BOOST_REQUIRE_EQUAL(calls.size(), 2u);
+    BOOST_CHECK_EQUAL(calls[0], 7); // keyed slots first
+    BOOST_CHECK_EQUAL(calls[1], -1);
+
+    BOOST_CHECK_EQUAL(s.count(7), 1u);
+    connections[7].disconnect();
+    BOOST_CHECK_EQUAL(s.count(7), 0u);
+    calls.clear();
+    s(7, "x");
+    BOOST_REQUIRE_EQUAL(calls.size(), 1u);
+    BOOST_CHECK_EQUAL(calls[0], -1);
+    BOOST_CHECK(!s.empty());
+}
+
+BOOST_AUTO_TEST_CASE(keyed_rehash)
+{
+    KeyedSignal<std::string, int(std::string const&)> s;
+    BOOST_CHECK(s.empty());
+    BOOST_CHECK_THROW(s("a"), SsigError);
+    std::vector<Connection<int(std::string const&)>> connections;
+    for (int i = 0; i < 1000; ++i) {
+        connections.push_back(s.connect(std::to_string(i),
+            [i](std::string const&) { return i; }));
+        if (i % 2)
+            connections[i - 1].disconnect(); // keys without slots are dropped
+    }
+    for (int i = 1; i < 1000; i += 2)
+        BOOST_CHECK_EQUAL(s(std::to_string(i)), i);
+    BOOST_CHECK_EQUAL(s.count("998"), 0u);
+    BOOST_CHECK_THROW(s("998"), SsigError);
+    s.connectAny([](std::string const&) { return -1; });
+    BOOST_CHECK_EQUAL(s("3"), -1); // the slot called last
+    BOOST_CHECK_EQUAL(s("998"), -1);
+}
+
+BOOST_AUTO_TEST_CASE(keyed_connect_during_emission)
+{
+    Connection<void(int)> c;
+    {
+        KeyedSignal<int, void(int)> s;
+        int n = 0;
+        c = s.connect(1, [&](int) {
+            ++n;
+            for (int key = 2; key < 100; ++key)
+                s.connect(key, [&n](int) { ++n; });
+            c.disconnect();
+        });
+        s(1);
+        s(1);
+        BOOST_CHECK_EQUAL(n, 1);
+        s(50);
+        BOOST_CHECK_EQUAL(n, 2);
+        c = s.connect(3, [](int) { });
+    }
+    BOOST_CHECK(!c.isConnected());
+}
+
+BOOST_AUTO_TEST_CASE(keyed_recursive_emission)
+{
+    KeyedSignal<int, void(int)> s;
+    int n = 0;
+    s.connect(1, [&](int) {
+        ++n;
+        BOOST_CHECK_THROW(s(2), SsigError); // recursive, although for another key
+    });
+    s.connect(2, [&n](int) { ++n; });
+    s.connectAny([&](int key) {
+        if (key == 2)
+            BOOST_CHECK_THROW(s(1), SsigError);
+    });
+    s(1);
+    s(2);
+    BOOST_CHECK_EQUAL(n, 2);
+}
+
+namespace {
+
+// Counts its comparisons, i.e. the probed buckets of a lookup.
+struct CountingEqual {
+    explicit CountingEqual(unsigned* n = nullptr): n(n) { }
+    bool operator() (std::size_t a, std::size_t b) const { ++*n; return a == b; }
+    unsigned* n;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(keyed_strided_keys)
+{
+    // Strided keys must spread over the buckets also if the hash is the
+    // identity, as std::hash is for integers in libstdc++.
+    unsigned numCompared = 0;
+    std::size_t const numKeys = 1000, stride = 4096;
+    KeyedSignal<std::size_t, void(std::size_t), boost::function<void(std::size_t)>,
+        std::allocator<void>, SingleThreaded, std::hash<std::size_t>, CountingEqual>
+        s((std::hash<std::size_t>()), CountingEqual(&numCompared));
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < numKeys; ++i)
+        s.connect(i * stride, [&sum](std::size_t key) { sum += key; });
+    numCompared = 0;
+    for (std::size_t i = 0; i < numKeys; ++i)
+        s(i * stride);
+    BOOST_CHECK_EQUAL(sum, stride * numKeys * (numKeys - 1) / 2);
+    BOOST_CHECK_LT(numCompared, 3 * numKeys);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(typed_signals)
+
+namespace {
+
+struct Adder {
+    explicit Adder(int& total): total(&total) { }
+    void operator() (int i) const { *total += i; }
+    int* total;
+};
+
+struct Account {
+    Account(): balance(0) { }
+    int deposit(int amount) { return balance += amount; }
+    int balance;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(typed_signal)
+{
+    int total = 0;
+    TypedSignal<void(int), Adder> s;
+    Connection<void(int), Adder> c1 = s.connect(Adder(total));
+    {
+        ScopedConnection<void(int), Adder> c2 = s.connect(Adder(total));
+        s(1);
+        BOOST_CHECK_EQUAL(total, 2);
+        c1.invokeSlot(1);
+        BOOST_CHECK_EQUAL(total, 3);
+    }
+    s(1);
+    BOOST_CHECK_EQUAL(total, 4);
+    c1.disconnect();
+    BOOST_CHECK(s.empty());
+
+    // Compaction moves the slots.
+    std::vector<Connection<void(int), Adder>> connections;
+    for (int i = 0; i < 100; ++i)
+        connections.push_back(s.connect(Adder(total)));
+    for (int i = 0; i < 100; i += 2)
+        connections[i].disconnect();
+    total = 0;
+    s(1);
+    BOOST_CHECK_EQUAL(total, 50);
+    BOOST_CHECK_EQUAL(s.tombstones(), 0u);
+    connections[1].invokeSlot(1);
+    BOOST_CHECK_EQUAL(total, 51);
+}
+
+BOOST_AUTO_TEST_CASE(typed_signal_member_slots)
+{
+    typedef MemberSlot<Account, int(int), &Account::deposit> slot_t;
+    Account accounts[2];
+    TypedSignal<int(int), slot_t> s;
+    s.connect(slot_t(accounts[0]));
+    s.connect(slot_t(accounts[1]));
+    BOOST_CHECK_EQUAL(s(1), 1);
+    BOOST_CHECK_EQUAL(s(2), 3); // the slot connected first is called last
+    BOOST_CHECK_EQUAL(accounts[1].balance, 3);
+}
+
+namespace {
+
+struct Disconnector {
+    typedef Connection<void(int), Disconnector> connection_t;
+    Disconnector(connection_t* target, int* calls): target(target), calls(calls) { }
+    void operator() (int) const
+    {
+        ++*calls;
+        if (target->isConnected())
+            target->disconnect();
+    }
+    connection_t* target;
+    int* calls;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(typed_signal_disconnect_during_emission)
+{
+    TypedSignal<void(int), Disconnector> s;
+    int firstCalls = 0, secondCalls = 0;
+    Disconnector::connection_t first, second;
+    first = s.connect(Disconnector(&first, &firstCalls)); // disconnects itself
+    second = s.connect(Disconnector(&first, &secondCalls)); // called first
+    s(1);
+    BOOST_CHECK_EQUAL(secondCalls, 1);
+    BOOST_CHECK_EQUAL(firstCalls, 0);
+    BOOST_CHECK(!first.isConnected());
+    BOOST_CHECK(second.isConnected());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(many_arguments)
+
+BOOST_AUTO_TEST_CASE(arity_is_unlimited)
+{
+    typedef Signal<int(int, int, int, int, int, int, int, int)> signal_type;
+    signal_type s;
+    ScopedConnection<int(int, int, int, int, int, int, int, int)> c = s.connect(
+        [](int a, int b, int c, int d, int e, int f, int g, int h) {
+            return a + b + c + d + e + f + g + h;
+        });
+    BOOST_CHECK_EQUAL(s(1, 2, 3, 4, 5, 6, 7, 8), 36);
+    BOOST_CHECK_EQUAL(c.invokeSlot(1, 1, 1, 1, 1, 1, 1, 1), 8);
+
+    Delegate<void(int, int, int, int, int, int, int)> d =
+        [](int, int, int, int, int, int, int) { };
+    d(1, 2, 3, 4, 5, 6, 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(slot_table)
+
+BOOST_AUTO_TEST_CASE(connect_while_called)
+{
+    Signal<void()> s;
+    unsigned numCalls = 0;
+    std::vector<Connection<void()>> connections;
+    s.connect([&]() {
+        ++numCalls;
+        connections.push_back(s.connect([&numCalls]() { numCalls += 10; }));
+        BOOST_CHECK(connections.back().isConnected());
+    });
+    s();
+    BOOST_CHECK_EQUAL(numCalls, 1u);
+    s();
+    BOOST_CHECK_EQUAL(numCalls, 1u + 1u + 10u);
+    connections.front().disconnect();
+    s();
+    BOOST_CHECK_EQUAL(numCalls, 12u + 1u + 10u);
+}
+
+BOOST_AUTO_TEST_CASE(emit_from_invoked_slot)
+{
+    // An emission by a slot called through invokeSlot() must not compact
+    // the table, which would move the running slot.
+    typedef Signal<void(), Delegate<void()>> signal_type;
+    signal_type s;
+    s.setCompactionThreshold(0.f);
+    struct Context {
+        signal_type* signal;
+        signal_type::connection_type first;
+        int seen;
+    } context = { &s, s.connect([]() { }), 0 };
+    auto const payload = std::make_shared<int>(42);
+    auto self = s.connect([&context, payload]() {
+        if (context.first.isConnected()) {
+            context.first.disconnect();
+            (*context.signal)();
+        }
+        context.seen = *payload; // the slot's own copy of payload
+    });
+    self.invokeSlot();
+    BOOST_CHECK_EQUAL(context.seen, 42);
+    BOOST_CHECK_EQUAL(s.tombstones(), 1u);
+    s(); // compacts
+    BOOST_CHECK_EQUAL(s.tombstones(), 0u);
+    BOOST_CHECK(self.isConnected());
+}
+
+BOOST_AUTO_TEST_CASE(handles_survive_compaction)
+{
+    Signal<unsigned(unsigned)> s;
+    std::vector<Connection<unsigned(unsigned)>> connections;
+    for (unsigned i = 0; i < 100; ++i)
+        connections.push_back(s.connect([i](unsigned j) { return i + j; }));
+    for (unsigned i = 0; i < 100; i += 2)
+        connections[i].disconnect();
+    BOOST_CHECK_EQUAL(s(1000), 1001u); // compacts; first live slot returns
+    for (unsigned i = 0; i < 100; ++i) {
+        BOOST_CHECK_EQUAL(connections[i].isConnected(), i % 2 != 0);
+        if (i % 2)
+            BOOST_CHECK_EQUAL(connections[i].invokeSlot(1000), 1000u + i);
+    }
+
+    // Reused slot ids must not revive stale connections.
+    auto const stale = connections[0];
+    connections[0] = s.connect([](unsigned j) { return j; });
+    BOOST_CHECK(!stale.isConnected());
+    BOOST_CHECK(connections[0].isConnected());
+
+    for (auto& c: connections) {
+        if (c.isConnected())
+            c.disconnect();
+    }
+    BOOST_CHECK(s.empty());
+}
+
+BOOST_AUTO_TEST_CASE(batched_compaction)
+{
+    Signal<void()> s;
+    unsigned numCalls = 0;
+    std::vector<Connection<void()>> connections;
+    for (unsigned i = 0; i < 8; ++i)
+        connections.push_back(s.connect([&numCalls]() { ++numCalls; }));
+
+    connections[0].disconnect();
+    connections[1].disconnect();
+    BOOST_CHECK_EQUAL(s.tombstones(), 2u);
+    s(); // 2 of 8 dead: below the default threshold of 1/4
+    BOOST_CHECK_EQUAL(numCalls, 6u);
+    BOOST_CHECK_EQUAL(s.tombstones(), 2u);
+
+    connections[2].disconnect();
+    s();
+    BOOST_CHECK_EQUAL(numCalls, 11u);
+    BOOST_CHECK_EQUAL(s.tombstones(), 0u);
+
+    s.setCompactionThreshold(1.f);
+    for (unsigned i = 3; i < 8; ++i)
+        connections[i].disconnect();
+    s();
+    BOOST_CHECK_EQUAL(numCalls, 11u);
+    BOOST_CHECK_EQUAL(s.tombstones(), 5u);
+    BOOST_CHECK(s.empty());
+    s.compact();
+    BOOST_CHECK_EQUAL(s.tombstones(), 0u);
+
+    auto c = s.connect([&s]() { BOOST_CHECK_THROW(s.compact(), SsigError); });
+    s();
+}
+
+BOOST_AUTO_TEST_CASE(batch_emission)
+{
+    Signal<void(int, std::string const&)> s;
+    std::vector<std::string> calls;
+    s.emitBatch(std::vector<std::tuple<int, std::string>>()); // no slots, no events
+    Connection<void(int, std::string const&)> c1;
+    c1 = s.connect([&](int i, std::string const& str) {
+        calls.push_back("1:" + str + std::to_string(i));
+        if (i == 2)
+            c1.disconnect();
+    });
+    s.connect([&calls](int i, std::string const& str) {
+        calls.push_back("2:" + str + std::to_string(i));
+    });
+
+    std::vector<std::tuple<int, std::string>> const events = {
+        std::make_tuple(1, "a"), std::make_tuple(2, "b"), std::make_tuple(3, "c")};
+    s.emitBatch(events);
+    BOOST_CHECK(calls == std::vector<std::string>(
+        {"2:a1", "2:b2", "2:c3", "1:a1", "1:b2"}));
+
+    calls.clear();
+    s.emitBatch(events.begin() + 2, events.end());
+    BOOST_CHECK(calls == std::vector<std::string>({"2:c3"}));
+}
+
+BOOST_AUTO_TEST_CASE(release_slots_disconnected_while_called)
+{
+    // Slots disconnected during an emission release their resources when it
+    // ends, not at the next compaction.
+    Signal<void()> s;
+    s.setCompactionThreshold(1.f);
+    for (int i = 0; i < 8; ++i)
+        s.connect([]() { });
+    auto payload = std::make_shared<int>(0);
+    std::weak_ptr<int> const watcher = payload;
+    Connection<void()> self;
+    self = s.connect([&self, payload]() { self.disconnect(); });
+    auto pending = s.connect([&]() {
+        s.connect([payload]() { }).disconnect(); // connected and disconnected while pending
+    });
+    payload.reset();
+    BOOST_CHECK(!watcher.expired());
+    s();
+    pending.disconnect();
+    BOOST_CHECK(watcher.expired());
+    BOOST_CHECK_EQUAL(s.tombstones(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(live_slot_count)
+{
+    Signal<void()> s;
+    BOOST_CHECK_EQUAL(s.size(), 0u);
+    auto c1 = s.connect([]() { });
+    Connection<void()> c2;
+    c2 = s.connect([&]() {
+        c2.disconnect();
+        BOOST_CHECK_EQUAL(s.size(), 1u);
+        s.connect([]() { }); // pending, but counted
+        BOOST_CHECK_EQUAL(s.size(), 2u);
+    });
+    BOOST_CHECK_EQUAL(s.size(), 2u);
+    s();
+    BOOST_CHECK_EQUAL(s.size(), 2u);
+    c1.disconnect();
+    BOOST_CHECK_EQUAL(s.size(), 1u);
+    BOOST_CHECK(!s.empty());
+}
+
+BOOST_AUTO_TEST_CASE(lazy_emission)
+{
+    Signal<void(std::string const&, int)> s;
+    unsigned numBuilds = 0;
+    auto build = [&numBuilds]() {
+        ++numBuilds;
+        return std::make_tuple(std::string("payload"), 42);
+    };
+    BOOST_CHECK(!s.emitLazy(build));
+    BOOST_CHECK_EQUAL(numBuilds, 0u);
+
+    std::string received;
+    auto c = s.connect([&received](std::string const& str, int i) {
+        received = str + std::to_string(i);
+    });
+    BOOST_CHECK(s.emitLazy(build));
+    BOOST_CHECK_EQUAL(numBuilds, 1u);
+    BOOST_CHECK_EQUAL(received, "payload42");
+
+    c.disconnect();
+    BOOST_CHECK(!s.emitLazy(build));
+    BOOST_CHECK_EQUAL(numBuilds, 1u);
+}
+
+BOOST_AUTO_TEST_CASE(slot_priorities)
+{
+    enum Phase { physics = -1, gameplay, ui };
+    Signal<void()> s;
+    std::string calls;
+    s.connect(ui, [&calls]() { calls += "u1"; });
+    s.connect([&calls]() { calls += "g1"; });
+    s.connect(physics, [&calls]() { calls += "p1"; });
+    auto g2 = s.connect(gameplay, [&calls]() { calls += "g2"; });
+    s.connect(ui, [&calls]() { calls += "u2"; });
+    s.connect(physics, [&calls]() { calls += "p2"; });
+    s();
+    BOOST_CHECK_EQUAL(calls, "p2p1g2g1u2u1"); // LIFO within each priority
+
+    // Handles follow the slots when bands grow or are compacted.
+    BOOST_CHECK(g2.isConnected());
+    calls.clear();
+    g2.invokeSlot();
+    BOOST_CHECK_EQUAL(calls, "g2");
+    g2.disconnect();
+    s.compact();
+    calls.clear();
+    s();
+    BOOST_CHECK_EQUAL(calls, "p2p1g1u2u1");
+
+    // Slots connected while the signal is called take their place afterwards.
+    Signal<void()> t;
+    std::string order;
+    t.connect(ui, [&]() {
+        order += 'u';
+        if (order.size() == 1)
+            t.connect(physics, [&order]() { order += 'p'; });
+    });
+    t();
+    order.clear();
+    t();
+    BOOST_CHECK_EQUAL(order, "pu");
+}
+
+BOOST_AUTO_TEST_CASE(priority_band_order)
+{
+    // With a single priority, slots are called in LIFO order as usual.
+    Signal<void()> s;
+    std::vector<int> calls;
+    std::vector<Connection<void()>> connections;
+    for (int i = 0; i < 4; ++i)
+        connections.push_back(s.connect(5, [&calls, i]() { calls.push_back(i); }));
+    s();
+    BOOST_CHECK(calls == std::vector<int>({3, 2, 1, 0}));
+
+    // Bands emptied by disconnection are dropped. Connecting to the bands
+    // in turn keeps the LIFO order within each of them.
+    for (auto& c: connections)
+        c.disconnect();
+    s.compact();
+    for (int i = 0; i < 30; ++i)
+        s.connect(i % 3, [&calls, i]() { calls.push_back(i); });
+    calls.clear();
+    s();
+    std::vector<int> expected;
+    for (int priority = 0; priority < 3; ++priority) {
+        for (int i = 27 + priority; i >= 0; i -= 3)
+            expected.push_back(i);
+    }
+    BOOST_CHECK(calls == expected);
+}
+
+namespace {
+
+struct Recorder {
+    Recorder(): calls(nullptr), id(0) { }
+    Recorder(std::vector<int>& calls, int id): calls(&calls), id(id) { }
+    void operator() () const { calls->push_back(id); }
+    std::vector<int>* calls;
+    int id;
+    boost::shared_ptr<int> resource;
+};
+
+struct Logger {
+    explicit Logger(std::vector<int>& calls, int id): calls(&calls), id(id) { }
+    void log() { calls->push_back(id); }
+    std::vector<int>* calls;
+    int id;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(priority_free_slots)
+{
+    // The free slots of a band are default constructed, not copies of the
+    // slots connected to it.
+    std::vector<int> calls;
+    auto const resource = boost::make_shared<int>(0);
+    TypedSignal<void(), Recorder> s;
+    s.connect(Recorder(calls, 0));
+    Recorder r(calls, 1);
+    r.resource = resource;
+    s.connect(1, r);
+    r.resource.reset();
+    BOOST_CHECK_EQUAL(resource.use_count(), 2);
+    s.connect(1, Recorder(calls, 2));
+    s();
+    BOOST_CHECK(calls == std::vector<int>({0, 2, 1}));
+
+    // Slot types without a default constructor get no free slots.
+    std::vector<Logger> loggers;
+    for (int i = 0; i < 6; ++i)
+        loggers.push_back(Logger(calls, i));
+    typedef MemberSlot<Logger, void(), &Logger::log> slot_t;
+    TypedSignal<void(), slot_t> m;
+    for (int i = 0; i < 6; ++i)
+        m.connect(i % 2, slot_t(loggers[i]));
+    calls.clear();
+    m();
+    BOOST_CHECK(calls == std::vector<int>({4, 2, 0, 5, 3, 1}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(argument_passing)
+
+namespace {
+
+struct Counted {
+    Counted() { }
+    Counted(Counted const&) { ++copies; }
+    Counted(Counted&&) { ++moves; }
+    static void reset() { copies = moves = 0; }
+    static unsigned copies, moves;
+};
+
+unsigned Counted::copies = 0;
+unsigned Counted::moves = 0;
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(no_copies_by_reference)
+{
+    Signal<void(Counted const&)> s;
+    for (int i = 0; i < 3; ++i)
+        s.connect([](Counted const&) { });
+    Counted c;
+    Counted::reset();
+    s(c);
+    s(Counted());
+    BOOST_CHECK_EQUAL(Counted::copies, 0u);
+    BOOST_CHECK_EQUAL(Counted::moves, 0u);
+
+    Signal<int(Counted const&)> r;
+    auto con = r.connect([](Counted const&) { return 1; });
+    r.connect([](Counted const&) { return 2; });
+    Counted::reset();
+    r(c);
+    r.emit<Sum<int>>(c);
+    con.invokeSlot(c);
+    BOOST_CHECK_EQUAL(Counted::copies, 0u);
+    BOOST_CHECK_EQUAL(Counted::moves, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(one_copy_per_slot_by_value)
+{
+    // Arguments taken by value are copied once per slot which takes them by
+    // value, and not at all before.
+    typedef Signal<void(Counted), Delegate<void(Counted)>> signal_type;
+    signal_type s;
+    for (int i = 0; i < 3; ++i)
+        s.connect([](Counted) { });
+    s.connect([](Counted const&) { });
+    Counted c;
+    Counted::reset();
+    s(c);
+    BOOST_CHECK_EQUAL(Counted::copies, 3u);
+    BOOST_CHECK_EQUAL(Counted::moves, 0u);
+    Counted::reset();
+    s(Counted());
+    BOOST_CHECK_EQUAL(Counted::copies, 3u);
+    BOOST_CHECK_EQUAL(Counted::moves, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(one_copy_per_slot_with_default_function)
+{
+    // boost::function takes by-value parameters by value itself, so every
+    // slot copies the argument, whatever its own parameter type; the copy is
+    // then moved on to slots taking it by value.
+    Signal<void(Counted)> s;
+    for (int i = 0; i < 3; ++i)
+        s.connect([](Counted) { });
+    s.connect([](Counted const&) { });
+    Counted c;
+    Counted::reset();
+    s(c);
+    BOOST_CHECK_EQUAL(Counted::copies, 4u);
+}
+
+BOOST_AUTO_TEST_CASE(one_copy_per_executor_emission)
+{
+    Mailbox mailbox;
+    Signal<void(Counted const&)> s;
+    s.connect(mailbox, [](Counted const&) { });
+    Signal<void(Counted), Delegate<void(Counted)>> d;
+    d.connect(mailbox, [](Counted const&) { });
+    Counted c;
+    Counted::reset();
+    s(c);
+    d(c);
+    BOOST_CHECK_EQUAL(Counted::copies, 2u);
+    BOOST_CHECK_EQUAL(Counted::moves, 0u);
+    Counted::reset();
+    mailbox.pump();
+    BOOST_CHECK_EQUAL(Counted::copies, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(one_move_per_queued_emission)
+{
+    QueuedSignal<void(Counted const&)> s(2);
+    s.connect([](Counted const&) { });
+    s.connect([](Counted const&) { });
+    Counted::reset();
+    s(Counted());
+    s.drain();
+    BOOST_CHECK_EQUAL(Counted::copies, 0u);
+    BOOST_CHECK_EQUAL(Counted::moves, 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(delegates)
+
+namespace {
+
+struct Counter {
+    Counter(): n(0) { }
+    int add(int i) { return n += i; }
+    int get(int) const { return n; }
+    int n;
+};
+
+int twice(int i)
+{
+    return 2 * i;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(delegate_basics)
+{
+    typedef Delegate<int(int)> delegate_type;
+    delegate_type d;
+    BOOST_CHECK(d.empty());
+    BOOST_CHECK_THROW(d(1), SsigError);
+
+    d = &twice;
+    BOOST_CHECK(!d.empty());
+    BOOST_CHECK_EQUAL(d(3), 6);
+
+    int captured = 5;
+    d = [captured](int i) { return captured + i; };
+    delegate_type copy = d;
+    BOOST_CHECK_EQUAL(copy(1), 6);
+    delegate_type moved = std::move(copy);
+    BOOST_CHECK(copy.empty());
+    BOOST_CHECK_EQUAL(moved(2), 7);
+    moved.clear();
+    BOOST_CHECK(moved.empty());
+
+    // Non-trivially copyable callables are copied and destroyed properly.
+    auto shared = boost::make_shared<int>(10);
+    {
+        Delegate<int()> sd = [shared]() { return *shared; };
+        Delegate<int()> sd2 = sd;
+        BOOST_CHECK_EQUAL(shared.use_count(), 3);
+        BOOST_CHECK_EQUAL(sd2(), 10);
+    }
+    BOOST_CHECK_EQUAL(shared.use_count(), 1);
+
+    // Results are discarded for void delegates.
+    Delegate<void(int)> vd = &twice;
+    vd(1);
+}
+
+BOOST_AUTO_TEST_CASE(delegate_member_functions)
+{
+    Counter c;
+    auto add = Delegate<int(int)>::bind<Counter, &Counter::add>(&c);
+    auto get = Delegate<int(int)>::bind<Counter, &Counter::get>(&c);
+    BOOST_CHECK_EQUAL(add(3), 3);
+    BOOST_CHECK_EQUAL(add(4), 7);
+    BOOST_CHECK_EQUAL(get(0), 7);
+}
+
+BOOST_AUTO_TEST_CASE(delegate_signal)
+{
+    typedef Signal<int(int), Delegate<int(int)>> signal_type;
+    Counter c1, c2;
+    signal_type s;
+    BOOST_CHECK(s.empty());
+    signal_type::connection_type con1 = s.connect(
+        signal_type::function_type::bind<Counter, &Counter::add>(&c1));
+    ScopedConnection<int(int), Delegate<int(int)>> con2 = s.connect(
+        signal_type::function_type::bind<Counter, &Counter::add>(&c2));
+    s.connect(Delegate<int(int)>()); // empty slots are not connected
+    BOOST_CHECK_EQUAL(s(2), 2);
+    BOOST_CHECK_EQUAL(con2.invokeSlot(1), 3);
+    for (int i = 0; i < 10; ++i)
+        s(1);
+    BOOST_CHECK_EQUAL(c1.n, 12);
+    BOOST_CHECK_EQUAL(c2.n, 13);
+
+    con1.disconnect();
+    con2.disconnect();
+    BOOST_CHECK(s.empty());
+}
+
+BOOST_AUTO_TEST_CASE(delegate_from_null_function_pointer)
+{
+    typedef int (*function_pointer)(int);
+    Delegate<int(int)> d = static_cast<function_pointer>(nullptr);
+    BOOST_CHECK(d.empty());
+    BOOST_CHECK_THROW(d(1), SsigError);
+
+    Signal<int(int), Delegate<int(int)>> s;
+    BOOST_CHECK(!s.connect(static_cast<function_pointer>(nullptr)).isConnected());
+    BOOST_CHECK(s.empty());
+    BOOST_CHECK_THROW(s(1), SsigError);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(allocators)
+
+namespace {
+
+typedef Signal<int(int), Delegate<int(int)>, PoolAllocator<char>> pooled_signal;
+
+int increment(int i)
+{
+    return i + 1;
+}
+
+void runFrame(SlotPool& pool)
+{
+    pooled_signal s(pool);
+    std::vector<pooled_signal::connection_type> connections;
+    for (int i = 0; i < 100; ++i)
+        connections.push_back(s.connect(&increment));
+    BOOST_CHECK_EQUAL(s(1), 2);
+    for (std::size_t i = 0; i < connections.size(); i += 2)
+        connections[i].disconnect();
+    BOOST_CHECK_EQUAL(s(2), 3);
+    BOOST_CHECK(connections[1].isConnected());
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(pool_allocator)
+{
+    SlotPool pool(1024);
+    BOOST_CHECK_EQUAL(pool.capacity(), 0u);
+    runFrame(pool);
+    std::size_t const capacity = pool.capacity();
+    BOOST_CHECK(capacity > 0);
+
+    // Memory freed by the previous frame is reused.
+    runFrame(pool);
+    BOOST_CHECK_EQUAL(pool.capacity(), capacity);
+    pool.reset();
+    runFrame(pool);
+    BOOST_CHECK_EQUAL(pool.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE(connection_outlives_pooled_signal)
+{
+    SlotPool pool;
+    pooled_signal::connection_type c;
+    {
+        pooled_signal s(pool);
+        c = s.connect(&increment);
+        BOOST_CHECK(c.isConnected());
+    }
+    BOOST_CHECK(!c.isConnected());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(threading_policies)
+
+BOOST_AUTO_TEST_CASE(multi_threaded_policy)
+{
+    typedef Signal<int(), boost::function<int()>, std::allocator<void>, MultiThreaded> signal_type;
+    signal_type::connection_type c1, c2;
+    {
+        signal_type s;
+        c1 = s.connect([]() { return 1; });
+        c2 = c1;
+        ScopedConnection<int(), boost::function<int()>, std::allocator<void>, MultiThreaded> c3 =
+            s.connect([]() { return 2; });
+        BOOST_CHECK_EQUAL(s(), 1);
+        c2.disconnect();
+        BOOST_CHECK(!c1.isConnected());
+        BOOST_CHECK_EQUAL(s(), 2);
+        c1 = s.connect([]() { return 3; });
+    }
+    BOOST_CHECK(!c1.isConnected());
+    BOOST_CHECK(!c2.isConnected());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(static_signals)
+
+namespace {
+
+std::vector<int> g_calls;
+
+int hook1(int i)
+{
+    g_calls.push_back(1);
+    return i + 1;
+}
+
+int hook2(int i)
+{
+    g_calls.push_back(2);
+    return i + 2;
+}
+
+void appendTo(std::forward_list<int>& l)
+{
+    l.push_front(1);
+}
+
+struct FrameHooks {
+    SSIG_DEFINE_FIXEDSIGNAL(frameBegin, int(int), &hook1, &hook2)
+
+public:
+    static int emitFrameBegin(int i) { return sig_frameBegin()(i); }
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(static_signal)
+{
+    g_calls.clear();
+    StaticSignal<int(int), &hook1, &hook2> s;
+    BOOST_CHECK(!s.empty());
+    BOOST_CHECK_EQUAL(s(10), 12);
+    BOOST_CHECK(g_calls == std::vector<int>({1, 2}));
+
+    g_calls.clear();
+    {
+        auto c = s.connect([](int i) { g_calls.push_back(3); return i + 3; });
+        BOOST_CHECK_EQUAL(s(10), 13);
+        BOOST_CHECK(g_calls == std::vector<int>({1, 2, 3}));
+        c.disconnect();
+    }
+    BOOST_CHECK_EQUAL(s(10), 12);
+
+    StaticSignal<int(int)> empty;
+    BOOST_CHECK(empty.empty());
+    BOOST_CHECK_THROW(empty(1), SsigError);
+
+    StaticSignal<void(std::forward_list<int>&), &appendTo, &appendTo> ref;
+    std::forward_list<int> l;
+    ref(l);
+    BOOST_CHECK_EQUAL(std::distance(l.begin(), l.end()), 2);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_signal_macro)
+{
+    g_calls.clear();
+    BOOST_CHECK_EQUAL(FrameHooks::emitFrameBegin(0), 2);
+    ScopedConnection<int(int)> c = FrameHooks::connect_frameBegin(
+        [](int i) { return i + 10; });
+    BOOST_CHECK_EQUAL(FrameHooks::emitFrameBegin(0), 10);
+    BOOST_CHECK(g_calls == std::vector<int>({1, 2, 1, 2}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(concurrent_signals)
+
+BOOST_AUTO_TEST_CASE(concurrent_signal_basics)
+{
+    ConcurrentSignal<int(int)> s;
+    BOOST_CHECK(s.empty());
+    BOOST_CHECK_THROW(s(1), SsigError);
+    auto c1 = s.connect([](int i) { return i + 1; });
+    auto c2 = s.connect([](int i) { return i + 2; });
+    BOOST_CHECK(!s.empty());
+    BOOST_CHECK_EQUAL(s(1), 2); // reverse order of connection, as Signal
+    BOOST_CHECK_EQUAL(c2.invokeSlot(1), 3);
+    c1.disconnect();
+    BOOST_CHECK(!c1.isConnected());
+    BOOST_CHECK_THROW(c1.disconnect(), SsigError);
+    BOOST_CHECK_EQUAL(s(1), 3);
+
+    // Slots may disconnect themselves and emit recursively.
+    ConcurrentConnection<int(int)> self;
+    self = s.connect([&](int i) { self.disconnect(); return i > 0 ? s(i - 1) : 0; });
+    BOOST_CHECK_EQUAL(s(5), 7); // the recursive emission no longer sees the slot
+    BOOST_CHECK(!self.isConnected());
+    c2.disconnect();
+    BOOST_CHECK(s.empty());
+}
+
+BOOST_AUTO_TEST_CASE(concurrent_emission)
+{
+    ConcurrentSignal<void(int)> s;
+    std::atomic<long> sum(0);
+    auto permanent = s.connect([&sum](int i) { sum += i; });
+    std::atomic<bool> stop(false);
+
+    std::vector<std::thread> emitters;
+    std::atomic<long> numEmissions(0);
+    for (int t = 0; t < 4; ++t) {
+        emitters.emplace_back([&]() {
+            while (!stop.load()) {
+                s(1);
+                ++numEmissions;
+            }
+        });
+    }
+    for (int i = 0; i < 2000; ++i) {
+        auto c = s.connect([&sum](int) { sum += 0; });
+        c.disconnect();
+    }
+    stop = true;
+    for (auto& t: emitters)
+        t.join();
+    BOOST_CHECK_EQUAL(sum.load(), numEmissions.load());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(queued_signals)
+
+BOOST_AUTO_TEST_CASE(queued_signal_drain)
+{
+    QueuedSignal<void(int, std::string const&)> s(4);
+    std::vector<std::string> calls;
+    auto c1 = s.connect([&calls](int i, std::string const& str) {
+        calls.push_back("1:" + str + std::to_string(i));
+    });
+    auto c2 = s.connect([&calls](int i, std::string const& str) {
+        calls.push_back("2:" + str + std::to_string(i));
+    });
+    s(1, "a");
+    s(2, std::string("b"));
+    BOOST_CHECK(calls.empty());
+    BOOST_CHECK_EQUAL(s.pending(), 2u);
+
+    // Slot-major: each slot sees all events before the next slot is called.
+    BOOST_CHECK_EQUAL(s.drain(), 2u);
+    BOOST_CHECK(calls == std::vector<std::string>({"2:a1", "2:b2", "1:a1", "1:b2"}));
+    BOOST_CHECK_EQUAL(s.pending(), 0u);
+    BOOST_CHECK_EQUAL(s.drain(), 0u);
+
+    // The queue does not grow in steady state.
+    std::size_t const capacity = s.capacity();
+    for (int frame = 0; frame < 10; ++frame) {
+        for (int i = 0; i < 4; ++i)
+            s(i, "x");
+        s.drain();
+    }
+    BOOST_CHECK_EQUAL(s.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE(queued_signal_reentrancy)
+{
+    QueuedSignal<void(int)> s;
+    std::vector<int> seen;
+    Connection<void(int)> self;
+    self = s.connect([&](int i) {
+        seen.push_back(i);
+        if (i == 1)
+            self.disconnect(); // stops the rest of the batch for this slot
+    });
+    auto requeue = s.connect([&](int i) {
+        if (i < 10)
+            s(i + 10); // delivered by the next drain
+        BOOST_CHECK_THROW(s.drain(), SsigError);
+    });
+    s(0);
+    s(1);
+    s(2);
+    BOOST_CHECK_EQUAL(s.drain(), 3u);
+    BOOST_CHECK(seen == std::vector<int>({0, 1}));
+    BOOST_CHECK_EQUAL(s.pending(), 3u);
+    requeue.disconnect();
+    BOOST_CHECK(s.empty());
+    s.clear();
+    BOOST_CHECK_EQUAL(s.drain(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(queued_signal_batch_slots)
+{
+    QueuedSignal<void(int)> s;
+    std::vector<int> perEvent, batched;
+    std::size_t numBatches = 0;
+    s.connect([&](int i) { perEvent.push_back(i); });
+    auto batch = s.connectBatch([&](Span<int const> events) {
+        // Per-event slots have already seen the whole batch.
+        BOOST_CHECK_EQUAL(perEvent.size(), events.size());
+        batched.insert(batched.end(), events.begin(), events.end());
+        ++numBatches;
+    });
+    s(1);
+    s(2);
+    s(3);
+    BOOST_CHECK_EQUAL(s.drain(), 3u);
+    BOOST_CHECK(batched == std::vector<int>({1, 2, 3}));
+    BOOST_CHECK_EQUAL(numBatches, 1u);
+
+    // No call for an empty drain.
+    s.drain();
+    BOOST_CHECK_EQUAL(numBatches, 1u);
+
+    batch.disconnect();
+    s(4);
+    s.drain();
+    BOOST_CHECK_EQUAL(numBatches, 1u);
+    BOOST_CHECK_EQUAL(perEvent.size(), 4u);
+
+    // Signals with several parameters deliver tuples.
+    QueuedSignal<void(int, std::string const&)> t;
+    std::string joined;
+    t.connectBatch([&](Span<std::tuple<int, std::string> const> events) {
+        for (auto const& e: events)
+            joined += std::get<1>(e) + std::to_string(std::get<0>(e));
+    });
+    BOOST_CHECK(!t.empty());
+    t(1, "a");
+    t(2, "b");
+    t.drain();
+    BOOST_CHECK_EQUAL(joined, "a1b2");
+}
+
+BOOST_AUTO_TEST_CASE(emit_batch_of_values)
+{
+    Signal<void(int)> s;
+    int sum = 0;
+    s.connect([&sum](int i) { sum += i; });
+    s.emitBatch(std::vector<int>({1, 2, 3}));
+    BOOST_CHECK_EQUAL(sum, 6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(mailboxes)
+
+BOOST_AUTO_TEST_CASE(mailbox_basics)
+{
+    Mailbox mailbox(3);
+    BOOST_CHECK_EQUAL(mailbox.capacity(), 4u);
+    Signal<void(std::string const&)> s;
+    std::vector<std::string> received;
+    auto c = s.connect(mailbox, [&received](std::string const& str) {
+        received.push_back(str);
+    });
+    s("a");
+    s("b");
+    BOOST_CHECK(received.empty()); // not run by the emitting call
+    BOOST_CHECK_EQUAL(mailbox.pump(), 2u);
+    BOOST_CHECK(received == std::vector<std::string>({"a", "b"}));
+    BOOST_CHECK_EQUAL(mailbox.pump(), 0u);
+
+    for (int i = 0; i < 4; ++i)
+        s("c");
+    BOOST_CHECK_THROW(s("d"), SsigError);
+    BOOST_CHECK_EQUAL(mailbox.pump(), 4u);
+
+    // Pending invocations of disconnected slots are dropped.
+    s("e");
+    c.disconnect();
+    BOOST_CHECK_EQUAL(mailbox.pump(), 1u);
+    BOOST_CHECK_EQUAL(received.size(), 6u);
+}
+
+BOOST_AUTO_TEST_CASE(mailbox_multiple_producers)
+{
+    Mailbox mailbox(64);
+    long sum = 0;
+    int const numProducers = 4, numEmissions = 10000;
+
+    std::atomic<int> numDone(0);
+    std::vector<std::thread> producers;
+    for (int t = 0; t < numProducers; ++t) {
+        producers.emplace_back([&]() {
+            Signal<void(int)> s;
+            auto c = s.connect(mailbox, [&sum](int i) { sum += i; });
+            for (int i = 0; i < numEmissions; ++i) {
+                for (;;) {
+                    try {
+                        s(1);
+                        break;
+                    } catch (SsigError const&) {
+                        std::this_thread::yield(); // mailbox full
+                    }
+                }
+            }
+            // Keep the slot connected until the consumer is done.
+            ++numDone;
+            while (numDone.load() != 0)
+                std::this_thread::yield();
+        });
+    }
+    while (numDone.load() != numProducers)
+        mailbox.pump();
+    mailbox.pump();
+    numDone = 0;
+    for (auto& t: producers)
+        t.join();
+    BOOST_CHECK_EQUAL(sum, static_cast<long>(numProducers) * numEmissions);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(parallel_emission)
+
+BOOST_AUTO_TEST_CASE(thread_pool)
+{
+    ThreadPool pool(3);
+    BOOST_CHECK_EQUAL(pool.size(), 3u);
+    std::vector<std::atomic<int>> counts(1000);
+    for (auto& c: counts)
+        c = 0;
+    pool.parallelFor(counts.size(), [&counts](std::size_t i) { ++counts[i]; });
+    for (auto const& c: counts)
+        BOOST_CHECK_EQUAL(c.load(), 1);
+
+    BOOST_CHECK_THROW(pool.parallelFor(10, [](std::size_t i) {
+        if (i == 5)
+            throw SsigError("test");
+    }), SsigError);
+
+    ThreadPool inline_pool(0);
+    int sum = 0;
+    inline_pool.parallelFor(10, [&sum](std::size_t i) { sum += static_cast<int>(i); });
+    BOOST_CHECK_EQUAL(sum, 45);
+}
+
+BOOST_AUTO_TEST_CASE(emit_parallel)
+{
+    ThreadPool pool(3);
+    Signal<unsigned(unsigned)> s;
+    BOOST_CHECK_THROW(s.emitParallel<std::plus<unsigned>>(pool, 1), SsigError);
+    s.emitParallel(pool, 1); // results are discarded: no error
+
+    std::atomic<unsigned> numCalls(0);
+    std::vector<Connection<unsigned(unsigned)>> connections;
+    for (unsigned i = 0; i < 10000; ++i) {
+        connections.push_back(s.connect([&numCalls, i](unsigned j) {
+            ++numCalls;
+            return i * j;
+        }));
+    }
+    for (unsigned i = 0; i < 10000; i += 10)
+        connections[i].disconnect();
+
+    s.emitParallel(pool, 2);
+    BOOST_CHECK_EQUAL(numCalls.load(), 9000u);
+    unsigned expected = 0;
+    for (unsigned i = 0; i < 10000; ++i) {
+        if (i % 10)
+            expected += 2 * i;
+    }
+    BOOST_CHECK_EQUAL(s.emitParallel<std::plus<unsigned>>(pool, 2), expected);
+
+    // Reducing with a non-commutative operation keeps the sequential order:
+    // the slot connected first is the last one.
+    struct Second {
+        unsigned operator() (unsigned, unsigned b) const { return b; }
+    };
+    BOOST_CHECK_EQUAL(s.emitParallel<Second>(pool, 1), s(1));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(combiners)
+
+BOOST_AUTO_TEST_CASE(folding_combiners)
+{
+    Signal<int(int)> s;
+    BOOST_CHECK_EQUAL(s.emit<Sum<int>>(1), 0);
+    BOOST_CHECK_THROW(s.emit<Minimum<int>>(1), SsigError);
+    s.connect([](int i) { return i + 1; });
+    s.connect([](int i) { return i * 3; });
+    s.connect([](int i) { return i - 4; });
+    BOOST_CHECK_EQUAL(s.emit<Sum<int>>(2), 3 + 6 - 2);
+    BOOST_CHECK_EQUAL(s.emit<Minimum<int>>(2), -2);
+    BOOST_CHECK_EQUAL(s.emit<Maximum<int>>(2), 6);
+
+    int buffer[2];
+    CollectInto<int> collector(buffer, buffer + 2);
+    s.combine(collector, 2); // stops when the buffer is full
+    BOOST_CHECK_EQUAL(collector.result(), 2u);
+    BOOST_CHECK_EQUAL(buffer[0], -2); // in the order of operator()
+    BOOST_CHECK_EQUAL(buffer[1], 6);
+}
+
+BOOST_AUTO_TEST_CASE(short_circuit_combiners)
+{
+    Signal<bool(int)> s;
+    BOOST_CHECK(!s.emit<AnyOf>(0));
+    BOOST_CHECK(s.emit<AllOf>(0));
+
+    std::vector<int> calls;
+    s.connect([&calls](int i) { calls.push_back(1); return i > 1; });
+    s.connect([&calls](int i) { calls.push_back(2); return i > 0; });
+    BOOST_CHECK(s.emit<AnyOf>(1));
+    BOOST_CHECK(calls == std::vector<int>({2})); // stopped at the first true
+    calls.clear();
+    BOOST_CHECK(!s.emit<AllOf>(0));
+    BOOST_CHECK(calls == std::vector<int>({2})); // vetoed by the first slot
+    calls.clear();
+    BOOST_CHECK(s.emit<AllOf>(2));
+    BOOST_CHECK(calls == std::vector<int>({2, 1}));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,87 @@
+// Part of ssig -- Copyright (c) Christian Neumüller 2012--2013
+// This file is subject to the terms of the BSD 2-Clause License.
+// See LICENSE.txt or http://opensource.org/licenses/BSD-2-Clause
+
+// Tracing is enabled for all of ssig, so it is tested in a separate program.
+#define SSIG_ENABLE_TRACING
+
+#include "ssig.hpp"
+
+#define BOOST_TEST_MODULE SsigTraceTest
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+
+using namespace ssig; // Don't do this at home.
+
+namespace {
+
+std::size_t count(std::string const& s, std::string const& what)
+{
+    std::size_t n = 0;
+    for (std::size_t pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + 1))
+        ++n;
+    return n;
+}
+
+std::string trace()
+{
+    std::ostringstream out;
+    TraceRecorder::instance().writeChromeTrace(out);
+    return out.str();
+}
+
+class Window {
+    SSIG_DEFINE_MEMBERSIGNAL(resized, void(int, int))
+public:
+    void resize(int w, int h) { m_sig_resized(w, h); }
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(tracing)
+
+BOOST_AUTO_TEST_CASE(trace_events)
+{
+    TraceRecorder& recorder = TraceRecorder::instance();
+    recorder.clear();
+
+    Signal<int(int)> s("the \"signal\"");
+    s.connect([](int i) { return i; });
+    s.connect([](int i) { return i + 1; });
+    s(1); // not recording yet
+    BOOST_CHECK_EQUAL(count(trace(), "\"ph\""), 0u);
+
+    recorder.start();
+    s(1);
+    recorder.stop();
+    s(1);
+
+    std::string const json = trace();
+    BOOST_CHECK_EQUAL(count(json, "\"ph\": \"B\""), 3u);
+    BOOST_CHECK_EQUAL(count(json, "\"ph\": \"E\""), 3u);
+    BOOST_CHECK_EQUAL(count(json, "\"cat\": \"ssig.emit\""), 2u);
+    BOOST_CHECK_EQUAL(count(json, "\"cat\": \"ssig.slot\""), 4u);
+    BOOST_CHECK_EQUAL(count(json, "\"name\": \"the \\\"signal\\\"\""), 6u);
+    BOOST_CHECK_EQUAL(recorder.droppedEvents(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(member_signal_names)
+{
+    TraceRecorder& recorder = TraceRecorder::instance();
+    recorder.clear();
+    Window w;
+    recorder.start();
+    w.resize(1, 2); // no slots: only the emission
+    std::thread([&w]() { w.resize(3, 4); }).join();
+    recorder.stop();
+
+    std::string const json = trace();
+    BOOST_CHECK_EQUAL(count(json, "\"name\": \"resized\""), 4u);
+    BOOST_CHECK_EQUAL(count(json, "\"tid\": 1"), 2u);
+    BOOST_CHECK_EQUAL(count(json, "\"tid\": 2"), 2u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()